@@ -0,0 +1,219 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Rules are pooled and indexed by the wealth node they watch: each node
+   heads a chain of its own rules, so a mutation evaluates only the rules on
+   the nodes it touched, however many rules exist overall. Each user also
+   chains their rules so they can be listed and dropped with the account. */
+static AlertRule* g_alertPool = NULL;
+static int g_alertPoolSize = 0;
+static int g_alertPoolCapacity = 0;
+static int g_freeAlert = -1;
+
+static int monthOf(time_t when) {
+    struct tm* t = localtime(&when);
+    if (t == NULL) return 0;
+    return (t->tm_year + 1900) * 12 + t->tm_mon;
+}
+
+static int allocRule(void) {
+    int index;
+    if (g_freeAlert != -1) {
+        index = g_freeAlert;
+        g_freeAlert = g_alertPool[index].nextOnNode;
+    } else {
+        if (g_alertPoolSize >= g_alertPoolCapacity) {
+            int newCap = g_alertPoolCapacity ? g_alertPoolCapacity * 2 : 256;
+            AlertRule* grown = (AlertRule*)realloc(g_alertPool, sizeof(AlertRule) * newCap);
+            if (grown == NULL) return -1;
+            g_alertPool = grown;
+            g_alertPoolCapacity = newCap;
+        }
+        index = g_alertPoolSize++;
+    }
+    return index;
+}
+
+static void releaseRule(int index) {
+    g_alertPool[index].node = NULL;
+    g_alertPool[index].nextOnNode = g_freeAlert;
+    g_freeAlert = index;
+}
+
+int addAlertRule(UserProfile* user, AlertKind kind, const char* category, double threshold) {
+    if (user == NULL || user->wealthTreeRoot == NULL || threshold <= 0) return -1;
+
+    WealthNode* node = user->wealthTreeRoot;
+    if (kind != ALERT_NET_WORTH_DROP) {
+        WealthNode* expenses = findWealthNode(user->wealthTreeRoot, "Expenses");
+        node = (expenses && category) ? findWealthNode(expenses->firstChild, category) : NULL;
+        if (node == NULL) return -1;
+    } else if (threshold >= 100.0) {
+        return -1;
+    }
+
+    int index = allocRule();
+    if (index == -1) return -1;
+    AlertRule* rule = &g_alertPool[index];
+    rule->user = user;
+    rule->node = node;
+    rule->kind = kind;
+    rule->threshold = threshold;
+    rule->reference = (kind == ALERT_NET_WORTH_DROP) ? user->netWorth : node->value;
+    rule->period = monthOf(engineNow());
+    rule->fired = 0;
+    rule->nextOnNode = node->firstRule;
+    node->firstRule = index;
+    rule->nextOnUser = user->firstAlertRule;
+    user->firstAlertRule = index;
+    return index;
+}
+
+static void unlinkFromNode(int index) {
+    WealthNode* node = g_alertPool[index].node;
+    int* link = &node->firstRule;
+    while (*link != -1 && *link != index) link = &g_alertPool[*link].nextOnNode;
+    if (*link == index) *link = g_alertPool[index].nextOnNode;
+}
+
+int removeAlertRule(UserProfile* user, int position) {
+    if (user == NULL || position < 1) return 0;
+    int* link = &user->firstAlertRule;
+    for (int i = 1; *link != -1 && i < position; i++) link = &g_alertPool[*link].nextOnUser;
+    if (*link == -1) return 0;
+    int index = *link;
+    *link = g_alertPool[index].nextOnUser;
+    unlinkFromNode(index);
+    releaseRule(index);
+    return 1;
+}
+
+/* The wealth tree is freed along with the rules, so node chains are left
+   as they are. */
+void cancelUserAlerts(UserProfile* user) {
+    if (user == NULL) return;
+    int index = user->firstAlertRule;
+    while (index != -1) {
+        int next = g_alertPool[index].nextOnUser;
+        releaseRule(index);
+        index = next;
+    }
+    user->firstAlertRule = -1;
+    free(user->alertInbox);
+    user->alertInbox = NULL;
+}
+
+static void deliverAlert(UserProfile* user, const char* message) {
+    if (user->alertInbox == NULL) {
+        user->alertInbox = (AlertInbox*)calloc(1, sizeof(AlertInbox));
+        if (user->alertInbox == NULL) return;
+    }
+    AlertInbox* inbox = user->alertInbox;
+    time_t now = engineNow();
+    char stamp[20];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M", localtime(&now));
+    snprintf(inbox->messages[inbox->next], sizeof(inbox->messages[0]), "[%s] %s", stamp, message);
+    inbox->next = (inbox->next + 1) % ALERT_INBOX_SIZE;
+    if (inbox->count < ALERT_INBOX_SIZE) inbox->count++;
+    if (inbox->unread < ALERT_INBOX_SIZE) inbox->unread++;
+}
+
+static void evaluateRule(AlertRule* rule, double delta) {
+    char message[100];
+    WealthNode* node = rule->node;
+
+    switch (rule->kind) {
+        case ALERT_SINGLE_EXPENSE_ABOVE:
+            if (delta > rule->threshold) {
+                snprintf(message, sizeof(message), "Single %s expense of Rs.%.2f exceeds Rs.%.2f",
+                         node->name, delta, rule->threshold);
+                deliverAlert(rule->user, message);
+            }
+            break;
+
+        case ALERT_MONTHLY_SPEND_ABOVE: {
+            int month = monthOf(engineNow());
+            if (month != rule->period) {
+                rule->period = month;
+                rule->reference = node->value - delta;
+                rule->fired = 0;
+            }
+            double spent = node->value - rule->reference;
+            if (!rule->fired && spent > rule->threshold) {
+                rule->fired = 1;
+                snprintf(message, sizeof(message), "%s spending this month Rs.%.2f exceeds Rs.%.2f",
+                         node->name, spent, rule->threshold);
+                deliverAlert(rule->user, message);
+            }
+            break;
+        }
+
+        case ALERT_NET_WORTH_DROP: {
+            double worth = rule->user->netWorth;
+            if (worth > rule->reference) {
+                rule->reference = worth;
+                rule->fired = 0;
+            }
+            if (!rule->fired && rule->reference > 0 &&
+                worth < rule->reference * (1.0 - rule->threshold / 100.0)) {
+                rule->fired = 1;
+                snprintf(message, sizeof(message), "Net worth Rs.%.2f is down %.1f%% from Rs.%.2f",
+                         worth, 100.0 * (rule->reference - worth) / rule->reference, rule->reference);
+                deliverAlert(rule->user, message);
+            }
+            break;
+        }
+    }
+}
+
+void evaluateNodeRules(WealthNode* node, double delta) {
+    for (int index = node->firstRule; index != -1; index = g_alertPool[index].nextOnNode) {
+        evaluateRule(&g_alertPool[index], delta);
+    }
+}
+
+void printUserAlertRules(UserProfile* user) {
+    if (user == NULL || user->firstAlertRule == -1) {
+        printf("No alert rules.\n");
+        return;
+    }
+    printf("\n--- Alert Rules ---\n");
+    int i = 1;
+    for (int index = user->firstAlertRule; index != -1; index = g_alertPool[index].nextOnUser, i++) {
+        AlertRule* rule = &g_alertPool[index];
+        switch (rule->kind) {
+            case ALERT_MONTHLY_SPEND_ABOVE:
+                printf("  %d. %s spending this month > Rs.%.2f\n", i, rule->node->name, rule->threshold);
+                break;
+            case ALERT_SINGLE_EXPENSE_ABOVE:
+                printf("  %d. Single %s expense > Rs.%.2f\n", i, rule->node->name, rule->threshold);
+                break;
+            case ALERT_NET_WORTH_DROP:
+                printf("  %d. Net worth drops more than %.1f%% from its peak\n", i, rule->threshold);
+                break;
+        }
+    }
+}
+
+void printAlertInbox(UserProfile* user) {
+    if (user == NULL || user->alertInbox == NULL || user->alertInbox->count == 0) {
+        printf("No alerts.\n");
+        return;
+    }
+    AlertInbox* inbox = user->alertInbox;
+    printf("\n--- Alerts (newest first) ---\n");
+    for (int i = 1; i <= inbox->count; i++) {
+        int slot = (inbox->next - i + ALERT_INBOX_SIZE) % ALERT_INBOX_SIZE;
+        printf("  %s%s\n", i <= inbox->unread ? "* " : "  ", inbox->messages[slot]);
+    }
+    inbox->unread = 0;
+}
+
+void freeAlertPool(void) {
+    free(g_alertPool);
+    g_alertPool = NULL;
+    g_alertPoolSize = g_alertPoolCapacity = 0;
+    g_freeAlert = -1;
+}
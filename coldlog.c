@@ -0,0 +1,450 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Cold logs are a byte stream of entries, oldest first, each encoded as:
+     string  category
+     string  description
+     varint  zigzag(date - previous date), the first against baseDate
+     amount  paise << 4 | investment type << 1, or
+             type << 1 | 1, the raw double's bits, then that tag again
+   A string is its dictionary id + 1, or 0, its bytes one varint each, 0.
+   Category and description ids come from one dictionary shared by every
+   user, so "rent" is stored once however many logs mention it; once the
+   dictionary is full, new strings are written out in place.
+   Every field is made of varints and reads the same from either end, so
+   the log can be read newest first from the tail while compaction drops
+   entries off the head. Dropped bytes stay in front of `start` until they
+   outweigh the live ones. */
+
+static char** g_dictStrings = NULL;
+static int g_dictCount = 0;
+static int g_dictCapacity = 0;
+static int* g_dictTable = NULL;
+static int g_dictTableSize = 0;
+static size_t g_dictBytes = 0;
+
+static unsigned int hashString(const char* s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int dictGrowTable(void) {
+    int newSize = g_dictTableSize ? g_dictTableSize * 2 : 256;
+    int* table = (int*)malloc(sizeof(int) * newSize);
+    if (table == NULL) return 0;
+    for (int i = 0; i < newSize; i++) table[i] = -1;
+    for (int id = 0; id < g_dictCount; id++) {
+        unsigned int slot = hashString(g_dictStrings[id]) & (unsigned int)(newSize - 1);
+        while (table[slot] != -1) slot = (slot + 1) & (unsigned int)(newSize - 1);
+        table[slot] = id;
+    }
+    free(g_dictTable);
+    g_dictTable = table;
+    g_dictTableSize = newSize;
+    return 1;
+}
+
+static int dictIntern(const char* s) {
+    if (g_dictTableSize == 0 && !dictGrowTable()) return -1;
+    unsigned int mask = (unsigned int)(g_dictTableSize - 1);
+    unsigned int slot = hashString(s) & mask;
+    while (g_dictTable[slot] != -1) {
+        if (strcmp(g_dictStrings[g_dictTable[slot]], s) == 0) return g_dictTable[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    if (g_dictCount >= COLD_LOG_DICT_MAX) return -1;
+    if ((g_dictCount + 1) * 2 > g_dictTableSize) {
+        if (!dictGrowTable()) return -1;
+        mask = (unsigned int)(g_dictTableSize - 1);
+        slot = hashString(s) & mask;
+        while (g_dictTable[slot] != -1) slot = (slot + 1) & mask;
+    }
+    if (g_dictCount >= g_dictCapacity) {
+        int newCap = g_dictCapacity ? g_dictCapacity * 2 : 256;
+        char** grown = (char**)realloc(g_dictStrings, sizeof(char*) * newCap);
+        if (grown == NULL) return -1;
+        g_dictStrings = grown;
+        g_dictCapacity = newCap;
+    }
+    size_t length = strlen(s) + 1;
+    char* copy = (char*)malloc(length);
+    if (copy == NULL) return -1;
+    memcpy(copy, s, length);
+    g_dictStrings[g_dictCount] = copy;
+    g_dictTable[slot] = g_dictCount;
+    g_dictBytes += length;
+    return g_dictCount++;
+}
+
+static int reserveBytes(ColdLog* log, size_t extra) {
+    if (log->length + extra <= log->capacity) return 1;
+    size_t newCap = log->capacity ? log->capacity * 2 : 64;
+    while (newCap < log->length + extra) newCap *= 2;
+    unsigned char* grown = (unsigned char*)realloc(log->bytes, newCap);
+    if (grown == NULL) return 0;
+    log->bytes = grown;
+    log->capacity = newCap;
+    return 1;
+}
+
+static int putVarint(ColdLog* log, unsigned long long v) {
+    if (!reserveBytes(log, 10)) return 0;
+    while (v >= 0x80) {
+        log->bytes[log->length++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    log->bytes[log->length++] = (unsigned char)v;
+    return 1;
+}
+
+static unsigned long long getVarint(const unsigned char* bytes, size_t* offset) {
+    unsigned long long v = 0;
+    int shift = 0;
+    unsigned char b;
+    do {
+        b = bytes[(*offset)++];
+        v |= (unsigned long long)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return v;
+}
+
+/* Reads the varint that ends just before *end. The byte in front of a
+   varint always ends another one, so its start is the first byte back
+   with the high bit clear. */
+static unsigned long long getVarintBefore(const unsigned char* bytes, size_t floor, size_t* end) {
+    size_t begin = *end - 1;
+    while (begin > floor && (bytes[begin - 1] & 0x80)) begin--;
+    *end = begin;
+    return getVarint(bytes, &begin);
+}
+
+static unsigned long long zigzag(long long v) {
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static long long unzigzag(unsigned long long v) {
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static int putString(ColdLog* log, const char* s) {
+    int id = dictIntern(s);
+    if (id != -1) return putVarint(log, (unsigned long long)id + 1);
+    if (!putVarint(log, 0)) return 0;
+    for (; *s; s++) {
+        if (!putVarint(log, (unsigned char)*s)) return 0;
+    }
+    return putVarint(log, 0);
+}
+
+static void getString(const unsigned char* bytes, size_t* offset, char* out, size_t size) {
+    unsigned long long v = getVarint(bytes, offset);
+    if (v != 0) {
+        snprintf(out, size, "%s", g_dictStrings[v - 1]);
+        return;
+    }
+    size_t length = 0;
+    while ((v = getVarint(bytes, offset)) != 0) {
+        if (length + 1 < size) out[length++] = (char)v;
+    }
+    out[length] = '\0';
+}
+
+static void getStringBefore(const unsigned char* bytes, size_t floor, size_t* end, char* out, size_t size) {
+    unsigned long long v = getVarintBefore(bytes, floor, end);
+    if (v != 0) {
+        snprintf(out, size, "%s", g_dictStrings[v - 1]);
+        return;
+    }
+    /* Literal bytes come off the tail last first; skip to the opening 0
+       and read them forward from there. */
+    size_t last = *end;
+    while (getVarintBefore(bytes, floor, end) != 0) {}
+    size_t offset = *end;
+    getVarint(bytes, &offset);
+    size_t length = 0;
+    while (offset < last) {
+        v = getVarint(bytes, &offset);
+        if (length + 1 < size) out[length++] = (char)v;
+    }
+    out[length] = '\0';
+}
+
+static void setAmount(ExpenditureNode* out, unsigned long long tag, unsigned long long bits) {
+    out->investmentType = (InvestmentType)((tag >> 1) & 7);
+    if (tag & 1) {
+        memcpy(&out->amount, &bits, sizeof(double));
+    } else {
+        out->amount = (double)(tag >> 4) / 100.0;
+    }
+}
+
+/* Decodes the entry at *offset, whose predecessor is dated prevDate. */
+static void decodeForward(const unsigned char* bytes, size_t* offset, time_t prevDate, ExpenditureNode* out) {
+    getString(bytes, offset, out->category, sizeof(out->category));
+    getString(bytes, offset, out->description, sizeof(out->description));
+    out->date = (time_t)((long long)prevDate + unzigzag(getVarint(bytes, offset)));
+    unsigned long long tag = getVarint(bytes, offset);
+    unsigned long long bits = 0;
+    if (tag & 1) {
+        bits = getVarint(bytes, offset);
+        getVarint(bytes, offset);
+    }
+    setAmount(out, tag, bits);
+    out->next = out->prev = NULL;
+}
+
+ColdLog* createColdLog(void) {
+    ColdLog* log = (ColdLog*)malloc(sizeof(ColdLog));
+    if (log == NULL) return NULL;
+    log->bytes = NULL;
+    log->length = 0;
+    log->capacity = 0;
+    log->start = 0;
+    log->count = 0;
+    log->baseDate = 0;
+    log->lastDate = 0;
+    log->oldestDate = 0;
+    return log;
+}
+
+/* Entries must be appended oldest first. A failed append leaves the log as
+   it was before the call. */
+int coldLogAppend(ColdLog* log, const ExpenditureNode* entry) {
+    if (log == NULL || entry == NULL) return 0;
+
+    size_t start = log->length;
+    long long paise = llround(entry->amount * 100.0);
+    unsigned long long type = (unsigned long long)entry->investmentType & 7;
+    int ok = putString(log, entry->category) &&
+             putString(log, entry->description) &&
+             putVarint(log, zigzag((long long)entry->date - (long long)log->lastDate));
+    if (ok && entry->amount >= 0 && paise < (1LL << 58) && (double)paise / 100.0 == entry->amount) {
+        ok = putVarint(log, (unsigned long long)paise << 4 | type << 1);
+    } else if (ok) {
+        unsigned long long bits;
+        memcpy(&bits, &entry->amount, sizeof(double));
+        ok = putVarint(log, type << 1 | 1) && putVarint(log, bits) && putVarint(log, type << 1 | 1);
+    }
+    if (!ok) {
+        log->length = start;
+        return 0;
+    }
+
+    if (log->count == 0) log->oldestDate = entry->date;
+    log->lastDate = entry->date;
+    log->count++;
+    return 1;
+}
+
+/* Gives back the growth slack once a log is complete. */
+void finishColdLog(ColdLog* log) {
+    if (log == NULL || log->length == 0 || log->length == log->capacity) return;
+    unsigned char* trimmed = (unsigned char*)realloc(log->bytes, log->length);
+    if (trimmed == NULL) return;
+    log->bytes = trimmed;
+    log->capacity = log->length;
+}
+
+void freeColdLog(ColdLog* log) {
+    if (log == NULL) return;
+    free(log->bytes);
+    free(log);
+}
+
+int coldLogOldest(const ColdLog* log, ExpenditureNode* out) {
+    if (log == NULL || log->count == 0) return 0;
+    size_t offset = log->start;
+    decodeForward(log->bytes, &offset, log->baseDate, out);
+    return 1;
+}
+
+/* Drops the head entry. The freed prefix is only given back once it is
+   larger than what is left, so each byte is moved at most once on
+   average. */
+void coldLogDropOldest(ColdLog* log) {
+    if (log == NULL || log->count == 0) return;
+    ExpenditureNode entry;
+    decodeForward(log->bytes, &log->start, log->baseDate, &entry);
+    log->baseDate = entry.date;
+    log->count--;
+    if (log->count == 0) {
+        log->length = log->start = 0;
+        return;
+    }
+
+    coldLogOldest(log, &entry);
+    log->oldestDate = entry.date;
+    if (log->start < log->length - log->start) return;
+    memmove(log->bytes, log->bytes + log->start, log->length - log->start);
+    log->length -= log->start;
+    log->start = 0;
+    finishColdLog(log);
+}
+
+void openExpenseCursor(ExpenseCursor* cursor, const ExpenditureNode* hot, const ColdLog* cold) {
+    cursor->hot = hot;
+    cursor->cold = cold;
+    cursor->offset = cold ? cold->length : 0;
+    cursor->remaining = cold ? cold->count : 0;
+    cursor->nextDate = cold ? cold->lastDate : 0;
+}
+
+/* Hot entries are always newer than the cold ones, so the merged stream
+   keeps the log's newest-first order; the cold stream is read from its
+   tail. Cold entries are decoded into the cursor's scratch node, which
+   the next call overwrites. */
+const ExpenditureNode* nextExpense(ExpenseCursor* cursor) {
+    if (cursor->hot != NULL) {
+        const ExpenditureNode* entry = cursor->hot;
+        cursor->hot = entry->next;
+        return entry;
+    }
+    if (cursor->remaining <= 0) return NULL;
+
+    const unsigned char* bytes = cursor->cold->bytes;
+    size_t floor = cursor->cold->start;
+    ExpenditureNode* out = &cursor->scratch;
+    unsigned long long tag = getVarintBefore(bytes, floor, &cursor->offset);
+    unsigned long long bits = 0;
+    if (tag & 1) {
+        bits = getVarintBefore(bytes, floor, &cursor->offset);
+        getVarintBefore(bytes, floor, &cursor->offset);
+    }
+    setAmount(out, tag, bits);
+    long long delta = unzigzag(getVarintBefore(bytes, floor, &cursor->offset));
+    getStringBefore(bytes, floor, &cursor->offset, out->description, sizeof(out->description));
+    getStringBefore(bytes, floor, &cursor->offset, out->category, sizeof(out->category));
+    out->date = cursor->nextDate;
+    out->next = out->prev = NULL;
+    cursor->nextDate = (time_t)((long long)out->date - delta);
+    cursor->remaining--;
+    return out;
+}
+
+/* Moves up to `budget` of the oldest hot entries onto the end of the cold
+   stream, so each call costs O(budget) whatever the size of either part.
+   Returns the number moved. */
+int freezeExpenseLog(UserProfile* user, int budget) {
+    if (user == NULL || user->expenseListTail == NULL || budget <= 0) return 0;
+    if (user->coldLog == NULL) {
+        user->coldLog = createColdLog();
+        if (user->coldLog == NULL) return 0;
+    }
+
+    int frozen = 0;
+    while (user->expenseListTail != NULL && frozen < budget) {
+        ExpenditureNode* oldest = user->expenseListTail;
+        if (!coldLogAppend(user->coldLog, oldest)) break;
+        user->expenseListTail = oldest->prev;
+        if (oldest->prev != NULL) {
+            oldest->prev->next = NULL;
+        } else {
+            user->expenseListHead = NULL;
+        }
+        free(oldest);
+        frozen++;
+    }
+    if (user->expenseListHead == NULL) finishColdLog(user->coldLog);
+    return frozen;
+}
+
+int coldLogDictionarySize(void) {
+    return g_dictCount;
+}
+
+const char* coldLogDictionaryString(int id) {
+    return (id >= 0 && id < g_dictCount) ? g_dictStrings[id] : NULL;
+}
+
+/* Snapshots store cold logs as their bytes, so the dictionary has to come
+   back with the same ids; fails if `s` would get a different one. */
+int restoreColdLogString(const char* s, int id) {
+    return id == g_dictCount && dictIntern(s) == id;
+}
+
+static int checkVarint(const ColdLog* log, size_t* offset, unsigned long long* v) {
+    *v = 0;
+    for (int shift = 0; shift < 64 && *offset < log->length; shift += 7) {
+        unsigned char b = log->bytes[(*offset)++];
+        *v |= (unsigned long long)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return 1;
+    }
+    return 0;
+}
+
+static int checkString(const ColdLog* log, size_t* offset) {
+    unsigned long long v;
+    if (!checkVarint(log, offset, &v)) return 0;
+    if (v != 0) return v <= (unsigned long long)g_dictCount;
+    for (int length = 0; length < 100; length++) {
+        if (!checkVarint(log, offset, &v) || v > 255) return 0;
+        if (v == 0) return 1;
+    }
+    return 0;
+}
+
+/* Walks a stream read from outside (a snapshot) and checks that it decodes
+   to exactly `count` entries ending at `lastDate`, with every dictionary id
+   in range, before anything trusts it. */
+int coldLogValid(const ColdLog* log) {
+    if (log == NULL || log->start > log->length || log->count <= 0) return 0;
+    size_t offset = log->start;
+    long long date = (long long)log->baseDate;
+    for (int i = 0; i < log->count; i++) {
+        unsigned long long delta, tag, bits, again;
+        if (!checkString(log, &offset) || !checkString(log, &offset) ||
+            !checkVarint(log, &offset, &delta) || !checkVarint(log, &offset, &tag)) return 0;
+        if ((tag & 1) && (!checkVarint(log, &offset, &bits) || !checkVarint(log, &offset, &again) || again != tag)) return 0;
+        date += unzigzag(delta);
+        if (i == 0 && date != (long long)log->oldestDate) return 0;
+    }
+    return offset == log->length && date == (long long)log->lastDate;
+}
+
+size_t coldLogMemoryUsage(const ColdLog* log) {
+    return log ? sizeof(ColdLog) + log->capacity : 0;
+}
+
+void printColdStorageReport(UserHeap* heap) {
+    if (heap == NULL || heap->size == 0) {
+        printf("\nNo users.\n");
+        return;
+    }
+    printf("\n--- Transaction Storage ---\n");
+    printf(" %-20s | %-6s | %-6s | %-10s | %-10s | %-10s\n",
+           "User", "Hot", "Cold", "Expanded", "Stored", "Saved");
+    size_t totalExpanded = 0, totalStored = 0;
+    for (int i = 0; i < heap->size; i++) {
+        UserProfile* user = heap->userArray[i];
+        int hot = 0;
+        for (ExpenditureNode* e = user->expenseListHead; e != NULL; e = e->next) hot++;
+        int cold = user->coldLog ? user->coldLog->count : 0;
+        size_t expanded = (size_t)cold * sizeof(ExpenditureNode);
+        size_t stored = coldLogMemoryUsage(user->coldLog);
+        printf(" %-20s | %-6d | %-6d | %-10zu | %-10zu | %-10lld\n",
+               user->name, hot, cold, expanded, stored, (long long)expanded - (long long)stored);
+        totalExpanded += expanded;
+        totalStored += stored;
+    }
+    printf("Cold entries would take %zu bytes expanded; stored in %zu bytes plus a %zu-byte shared dictionary (%d strings).\n",
+           totalExpanded, totalStored, g_dictBytes + sizeof(char*) * g_dictCapacity + sizeof(int) * g_dictTableSize,
+           g_dictCount);
+}
+
+void freeColdLogDictionary(void) {
+    for (int i = 0; i < g_dictCount; i++) free(g_dictStrings[i]);
+    free(g_dictStrings);
+    free(g_dictTable);
+    g_dictStrings = NULL;
+    g_dictTable = NULL;
+    g_dictCount = g_dictCapacity = g_dictTableSize = 0;
+    g_dictBytes = 0;
+}
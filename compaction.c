@@ -0,0 +1,194 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+long g_compactionHorizon = COMPACTION_DEFAULT_HORIZON;
+
+/* Where the background pass left off: the next heap slot to start, and
+   the user and list link it is part-way through. */
+static int g_compactionCursor = 0;
+static UserProfile* g_compactionUser = NULL;
+static ExpenditureNode** g_compactionLink = NULL;
+
+static int periodOf(time_t date) {
+    struct tm* t = localtime(&date);
+    if (t == NULL) return 0;
+    return (t->tm_year + 1900) * 12 + t->tm_mon;
+}
+
+/* Rollups are kept newest month first. Folds land in the months just past
+   the horizon, so the search stops after a handful of nodes instead of
+   walking every rollup the user has accumulated. */
+static ExpenseRollup* findOrCreateRollup(UserProfile* user, int period, const char* category,
+                                         const char* ticker, InvestmentType invType) {
+    ExpenseRollup** link = &user->rollupListHead;
+    while (*link != NULL && (*link)->period >= period) {
+        ExpenseRollup* r = *link;
+        if (r->period == period && r->investmentType == invType &&
+            strcmp(r->category, category) == 0 && strcmp(r->ticker, ticker) == 0) {
+            return r;
+        }
+        link = &r->next;
+    }
+
+    ExpenseRollup* r = (ExpenseRollup*)malloc(sizeof(ExpenseRollup));
+    if (r == NULL) return NULL;
+    r->period = period;
+    strncpy(r->category, category, 49);
+    r->category[49] = '\0';
+    strncpy(r->ticker, ticker, 49);
+    r->ticker[49] = '\0';
+    r->investmentType = invType;
+    r->amount = 0.0;
+    r->count = 0;
+    r->next = *link;
+    *link = r;
+    return r;
+}
+
+/* Stocks keep their ticker so per-ticker cost basis survives the fold;
+   every other entry is only ever totalled by category or investment type. */
+static ExpenseRollup* rollupFor(UserProfile* user, const ExpenditureNode* node) {
+    const char* ticker = (node->investmentType == INV_STOCKS) ? node->description : "";
+    return findOrCreateRollup(user, periodOf(node->date), node->category, ticker, node->investmentType);
+}
+
+static int foldIntoRollup(UserProfile* user, const ExpenditureNode* node) {
+    ExpenseRollup* r = rollupFor(user, node);
+    if (r == NULL) return 0;
+    r->amount += node->amount;
+    r->count++;
+    return 1;
+}
+
+/* The cold stream is oldest first, so everything old enough to fold is at
+   its head; folding stops at the first entry that stays. Each entry looked
+   at costs one unit, and a log with nothing to fold is never decoded. */
+static int compactColdLog(UserProfile* user, time_t cutoff, int budget, int* folded) {
+    ColdLog* log = user->coldLog;
+    if (log == NULL || log->count == 0 || log->oldestDate >= cutoff) return 0;
+
+    int visited = 0;
+    ExpenditureNode entry;
+    while (visited < budget && coldLogOldest(log, &entry)) {
+        visited++;
+        if (entry.date >= cutoff || !foldIntoRollup(user, &entry)) break;
+        coldLogDropOldest(log);
+        (*folded)++;
+    }
+    if (log->count == 0) {
+        freeColdLog(log);
+        user->coldLog = NULL;
+    }
+    return visited;
+}
+
+/* Folds old entries reachable from *link, visiting at most budget nodes.
+   Returns the nodes visited and leaves *link where the walk stopped. */
+static int foldHotEntries(UserProfile* user, ExpenditureNode*** link, time_t cutoff,
+                          int budget, int* folded) {
+    int visited = 0;
+    while (**link != NULL && visited < budget) {
+        ExpenditureNode* node = **link;
+        visited++;
+        if (node->date < cutoff && foldIntoRollup(user, node)) {
+            **link = node->next;
+            if (node->next != NULL) {
+                node->next->prev = node->prev;
+            } else {
+                user->expenseListTail = node->prev;
+            }
+            free(node);
+            (*folded)++;
+        } else {
+            *link = &node->next;
+        }
+    }
+    return visited;
+}
+
+int compactExpenseLog(UserProfile* user, time_t cutoff, int budget) {
+    if (user == NULL || budget <= 0) return 0;
+
+    int folded = 0;
+    ExpenditureNode** link = &user->expenseListHead;
+    int visited = foldHotEntries(user, &link, cutoff, budget, &folded);
+    compactColdLog(user, cutoff, budget - visited, &folded);
+    return folded;
+}
+
+void forgetCompactionCursor(UserProfile* user) {
+    if (user != NULL && user == g_compactionUser) {
+        g_compactionUser = NULL;
+        g_compactionLink = NULL;
+    }
+}
+
+/* Every user started and every entry looked at, folded or frozen costs one
+   unit of budget, so a step stays bounded no matter how many users or
+   entries there are. A user is worked through in three phases (walk the
+   list, fold the head of the cold stream, freeze the list if idle) and
+   whichever one runs out of budget is resumed by the next step.
+   Returns the number of entries folded or frozen. */
+int runCompactionStep(UserHeap* heap, int budget) {
+    if (heap == NULL || heap->userArray == NULL || heap->size <= 0 || budget <= 0) return 0;
+
+    time_t cutoff = engineNow() - g_compactionHorizon;
+    time_t idleCutoff = engineNow() - COLD_LOG_IDLE_SECONDS;
+    int moved = 0;
+    int work = 0;
+    int started = 0;
+    while (work < budget) {
+        if (g_compactionUser == NULL) {
+            if (started >= heap->size) break;
+            if (g_compactionCursor >= heap->size) g_compactionCursor = 0;
+            UserProfile* next = heap->userArray[g_compactionCursor++];
+            started++;
+            work++;
+            if (next == NULL) continue;
+            g_compactionUser = next;
+            g_compactionLink = &next->expenseListHead;
+        }
+
+        UserProfile* user = g_compactionUser;
+        if (g_compactionLink != NULL) {
+            work += foldHotEntries(user, &g_compactionLink, cutoff, budget - work, &moved);
+            if (*g_compactionLink != NULL) break;
+            g_compactionLink = NULL;
+        }
+
+        work += compactColdLog(user, cutoff, budget - work, &moved);
+        if (work >= budget) break;
+
+        if (user->expenseListHead != NULL && user->lastAccess < idleCutoff) {
+            int frozen = freezeExpenseLog(user, budget - work);
+            work += frozen;
+            moved += frozen;
+            if (user->expenseListHead != NULL && frozen > 0) break;
+        }
+        forgetCompactionCursor(user);
+    }
+    return moved;
+}
+
+void printExpenseRollups(ExpenseRollup* head) {
+    if (!head) return;
+    printf("\n--- Compacted History (monthly) ---\n");
+    ExpenseRollup* r = head;
+    while (r != NULL) {
+        printf("  [%04d-%02d] %s%s%s - Rs.%.2f (%d entries)\n",
+               r->period / 12, r->period % 12 + 1, r->category,
+               r->ticker[0] ? " / " : "", r->ticker, r->amount, r->count);
+        r = r->next;
+    }
+}
+
+void freeExpenseRollups(ExpenseRollup* head) {
+    ExpenseRollup* temp;
+    while (head != NULL) {
+        temp = head;
+        head = head->next;
+        free(temp);
+    }
+}
@@ -0,0 +1,205 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+FxCurrency g_fxCurrencies[FX_MAX_CURRENCIES] = { { FX_BASE_CURRENCY, 1.0, NULL, NULL, NULL, NULL, NULL, 0, 0 } };
+int g_fxCurrencyCount = 1;
+
+static UserProfile** g_fxDirtyUsers = NULL;
+static int g_fxDirtyCapacity = 0;
+
+static void normalizeCode(const char* code, char out[4]) {
+    int i = 0;
+    for (; i < 3 && code[i] != '\0'; i++) out[i] = (char)toupper((unsigned char)code[i]);
+    out[i] = '\0';
+}
+
+int fxFindCurrency(const char* code) {
+    if (code == NULL) return -1;
+    char normalized[4];
+    normalizeCode(code, normalized);
+    for (int i = 0; i < g_fxCurrencyCount; i++) {
+        if (strcmp(g_fxCurrencies[i].code, normalized) == 0) return i;
+    }
+    return -1;
+}
+
+const char* fxCurrencyCode(int currencyId) {
+    if (currencyId < 0 || currencyId >= g_fxCurrencyCount) return FX_BASE_CURRENCY;
+    return g_fxCurrencies[currencyId].code;
+}
+
+double fxConvertToBase(double amount, int currencyId) {
+    if (currencyId <= 0 || currencyId >= g_fxCurrencyCount) return amount;
+    return amount * g_fxCurrencies[currencyId].rate;
+}
+
+double fxConvertFromBase(double amount, int currencyId) {
+    if (currencyId <= 0 || currencyId >= g_fxCurrencyCount) return amount;
+    return amount / g_fxCurrencies[currencyId].rate;
+}
+
+static int growHoldings(FxCurrency* c) {
+    int newCap = c->capacity * 2;
+    if (newCap == 0) newCap = 16;
+    double* native = (double*)realloc(c->nativeValue, sizeof(double) * newCap);
+    if (native == NULL) return 0;
+    c->nativeValue = native;
+    double* base = (double*)realloc(c->baseValue, sizeof(double) * newCap);
+    if (base == NULL) return 0;
+    c->baseValue = base;
+    double* delta = (double*)realloc(c->delta, sizeof(double) * newCap);
+    if (delta == NULL) return 0;
+    c->delta = delta;
+    WealthNode** nodes = (WealthNode**)realloc(c->nodes, sizeof(WealthNode*) * newCap);
+    if (nodes == NULL) return 0;
+    c->nodes = nodes;
+    UserProfile** owners = (UserProfile**)realloc(c->owners, sizeof(UserProfile*) * newCap);
+    if (owners == NULL) return 0;
+    c->owners = owners;
+    c->capacity = newCap;
+    return 1;
+}
+
+int fxRegisterHolding(UserProfile* owner, WealthNode* node, int currencyId) {
+    if (owner == NULL || node == NULL || currencyId <= 0 || currencyId >= g_fxCurrencyCount) return 0;
+    if (node->fxSlot >= 0) return node->currencyId == currencyId;
+
+    FxCurrency* c = &g_fxCurrencies[currencyId];
+    if (c->count >= c->capacity && !growHoldings(c)) return 0;
+
+    int slot = c->count++;
+    c->nativeValue[slot] = node->value / c->rate;
+    c->baseValue[slot] = node->value;
+    c->nodes[slot] = node;
+    c->owners[slot] = owner;
+    node->currencyId = currencyId;
+    node->fxSlot = slot;
+    return 1;
+}
+
+void fxUnregisterHolding(WealthNode* node) {
+    if (node == NULL || node->fxSlot < 0) return;
+    FxCurrency* c = &g_fxCurrencies[node->currencyId];
+    int slot = node->fxSlot;
+    int last = --c->count;
+    if (slot != last) {
+        c->nativeValue[slot] = c->nativeValue[last];
+        c->baseValue[slot] = c->baseValue[last];
+        c->nodes[slot] = c->nodes[last];
+        c->owners[slot] = c->owners[last];
+        c->nodes[slot]->fxSlot = slot;
+    }
+    node->fxSlot = -1;
+    node->currencyId = 0;
+}
+
+double fxHoldingNativeValue(const WealthNode* node) {
+    if (node == NULL || node->fxSlot < 0) return node ? node->value : 0.0;
+    return g_fxCurrencies[node->currencyId].nativeValue[node->fxSlot];
+}
+
+void fxSetHoldingNativeValue(WealthNode* node, double nativeValue) {
+    if (node == NULL) return;
+    if (node->fxSlot < 0) {
+        node->value = nativeValue;
+        return;
+    }
+    FxCurrency* c = &g_fxCurrencies[node->currencyId];
+    c->nativeValue[node->fxSlot] = nativeValue;
+    c->baseValue[node->fxSlot] = nativeValue * c->rate;
+    node->value = c->baseValue[node->fxSlot];
+}
+
+static int markDirty(UserProfile* user, int dirtyCount) {
+    if (user->pendingFinalize) return dirtyCount;
+    if (dirtyCount >= g_fxDirtyCapacity) {
+        int newCap = g_fxDirtyCapacity ? g_fxDirtyCapacity * 2 : 64;
+        UserProfile** grown = (UserProfile**)realloc(g_fxDirtyUsers, sizeof(UserProfile*) * newCap);
+        if (grown == NULL) return dirtyCount;
+        g_fxDirtyUsers = grown;
+        g_fxDirtyCapacity = newCap;
+    }
+    user->pendingFinalize = 1;
+    g_fxDirtyUsers[dirtyCount] = user;
+    return dirtyCount + 1;
+}
+
+/* Revalues every holding in the currency in one pass over contiguous
+   arrays, then pushes each delta up the owning tree instead of re-walking
+   it. Each affected user is re-keyed in the heap once. */
+static void revalueCurrency(FxCurrency* c) {
+    const double rate = c->rate;
+    const int count = c->count;
+    const double* native = c->nativeValue;
+    double* base = c->baseValue;
+    double* delta = c->delta;
+    for (int i = 0; i < count; i++) {
+        double value = native[i] * rate;
+        delta[i] = value - base[i];
+        base[i] = value;
+    }
+
+    int dirtyCount = 0;
+    for (int i = 0; i < count; i++) {
+        double d = delta[i];
+        if (d == 0.0) continue;
+        WealthNode* root = c->nodes[i];
+        for (WealthNode* node = c->nodes[i]; node != NULL; node = node->parent) {
+            node->value += d;
+            root = node;
+        }
+        c->owners[i]->netWorth += d;
+        if (root->firstRule != -1) evaluateNodeRules(root, d);
+        dirtyCount = markDirty(c->owners[i], dirtyCount);
+    }
+
+    for (int i = 0; i < dirtyCount; i++) {
+        g_fxDirtyUsers[i]->pendingFinalize = 0;
+        heapUpdateKey(g_userHeap, g_fxDirtyUsers[i]);
+        recordNetWorthSample(g_fxDirtyUsers[i]);
+    }
+}
+
+int fxSetRate(const char* code, double rate) {
+    if (code == NULL || code[0] == '\0' || rate <= 0.0) return -1;
+
+    int id = fxFindCurrency(code);
+    if (id == 0) return rate == 1.0 ? 0 : -1;
+    if (id == -1) {
+        if (g_fxCurrencyCount >= FX_MAX_CURRENCIES) return -1;
+        id = g_fxCurrencyCount++;
+        FxCurrency* c = &g_fxCurrencies[id];
+        memset(c, 0, sizeof(FxCurrency));
+        normalizeCode(code, c->code);
+        c->rate = rate;
+        return id;
+    }
+
+    FxCurrency* c = &g_fxCurrencies[id];
+    if (c->rate != rate) {
+        c->rate = rate;
+        revalueCurrency(c);
+    }
+    return id;
+}
+
+void fxFreeTables(void) {
+    for (int i = 0; i < g_fxCurrencyCount; i++) {
+        FxCurrency* c = &g_fxCurrencies[i];
+        free(c->nativeValue);
+        free(c->baseValue);
+        free(c->delta);
+        free(c->nodes);
+        free(c->owners);
+        c->nativeValue = c->baseValue = c->delta = NULL;
+        c->nodes = NULL;
+        c->owners = NULL;
+        c->count = c->capacity = 0;
+    }
+    free(g_fxDirtyUsers);
+    g_fxDirtyUsers = NULL;
+    g_fxDirtyCapacity = 0;
+}
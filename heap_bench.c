@@ -0,0 +1,199 @@
+#include "wealth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The binary pointer heap that UserHeap replaced, kept here as the baseline. */
+typedef struct LegacyHeap {
+    UserProfile** userArray;
+    int size;
+    int capacity;
+} LegacyHeap;
+
+static int userCompare(const UserProfile* a, const UserProfile* b) {
+    if (a->netWorth > b->netWorth) return 1;
+    if (a->netWorth < b->netWorth) return -1;
+    int cmp = strcmp(a->name, b->name);
+    if (cmp < 0) return 1;
+    if (cmp > 0) return -1;
+    return 0;
+}
+
+static void legacySwap(LegacyHeap* heap, int i, int j) {
+    UserProfile* temp = heap->userArray[i];
+    heap->userArray[i] = heap->userArray[j];
+    heap->userArray[j] = temp;
+}
+
+static void legacyUp(LegacyHeap* heap, int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (userCompare(heap->userArray[index], heap->userArray[parent]) <= 0) break;
+        legacySwap(heap, index, parent);
+        index = parent;
+    }
+}
+
+static void legacyDown(LegacyHeap* heap, int index) {
+    while (1) {
+        int left = index * 2 + 1;
+        int right = index * 2 + 2;
+        int largest = index;
+        if (left < heap->size && userCompare(heap->userArray[left], heap->userArray[largest]) > 0) largest = left;
+        if (right < heap->size && userCompare(heap->userArray[right], heap->userArray[largest]) > 0) largest = right;
+        if (largest == index) break;
+        legacySwap(heap, index, largest);
+        index = largest;
+    }
+}
+
+static void legacyInsert(LegacyHeap* heap, UserProfile* user) {
+    heap->userArray[heap->size] = user;
+    legacyUp(heap, heap->size);
+    heap->size++;
+}
+
+static void legacyUpdate(LegacyHeap* heap, UserProfile* user, double oldNetWorth) {
+    int index = -1;
+    for (int i = 0; i < heap->size; i++) {
+        if (heap->userArray[i] == user) { index = i; break; }
+    }
+    if (index == -1) return;
+    if (user->netWorth > oldNetWorth) legacyUp(heap, index);
+    else if (user->netWorth < oldNetWorth) legacyDown(heap, index);
+}
+
+static UserProfile* legacyPop(LegacyHeap* heap) {
+    UserProfile* top = heap->userArray[0];
+    heap->size--;
+    heap->userArray[0] = heap->userArray[heap->size];
+    legacyDown(heap, 0);
+    return top;
+}
+
+static unsigned long long rngState = 88172645463325252ULL;
+
+static unsigned long long nextRandom(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+/* Coarse values so that equal net worths (and the name tie-break) are common. */
+static double randomWorth(void) {
+    return (double)(nextRandom() % 100000) * 10.0;
+}
+
+static double elapsedNs(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static void runSize(int n) {
+    UserProfile* users = (UserProfile*)calloc(n, sizeof(UserProfile));
+    LegacyHeap legacy;
+    legacy.userArray = (UserProfile**)malloc(sizeof(UserProfile*) * n);
+    legacy.size = 0;
+    legacy.capacity = n;
+    UserHeap* heap = createHeap(n);
+    if (users == NULL || legacy.userArray == NULL || heap == NULL) {
+        printf("%10d users: allocation failed\n", n);
+        free(users);
+        free(legacy.userArray);
+        freeHeap(heap);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        snprintf(users[i].name, sizeof(users[i].name), "user%09d", i);
+        users[i].netWorth = randomWorth();
+        users[i].heapId = -1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < n; i++) legacyInsert(&legacy, &users[i]);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double legacyBuild = elapsedNs(t0, t1) / n;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < n; i++) heapInsert(heap, &users[i]);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double newBuild = elapsedNs(t0, t1) / n;
+
+    /* The legacy update pays a linear findUserIndex, so cap its sample. */
+    int updates = n < 1000000 ? n : 1000000;
+    int legacyUpdates = (int)(2000000000LL / n);
+    if (legacyUpdates > updates) legacyUpdates = updates;
+    if (legacyUpdates < 10) legacyUpdates = 10;
+    int* who = (int*)malloc(sizeof(int) * updates);
+    double* worth = (double*)malloc(sizeof(double) * updates);
+    for (int i = 0; i < updates; i++) {
+        who[i] = (int)(nextRandom() % (unsigned long long)n);
+        worth[i] = randomWorth();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < legacyUpdates; i++) {
+        UserProfile* user = &users[who[i]];
+        double old = user->netWorth;
+        user->netWorth = worth[i];
+        legacyUpdate(&legacy, user, old);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double legacyUpdateNs = elapsedNs(t0, t1) / legacyUpdates;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < updates; i++) {
+        UserProfile* user = &users[who[i]];
+        user->netWorth = worth[i];
+        heapUpdateKey(heap, user);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double newUpdateNs = elapsedNs(t0, t1) / updates;
+
+    /* Only a sample went through the legacy heap; re-heapify it untimed so
+       both heaps agree on the final keys before comparing pop order. */
+    for (int i = legacy.size / 2 - 1; i >= 0; i--) {
+        legacyDown(&legacy, i);
+    }
+
+    int removals = n < 100000 ? n : 100000;
+    UserProfile** popped = (UserProfile**)malloc(sizeof(UserProfile*) * removals);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < removals; i++) {
+        popped[i] = getTopWealthUser(heap);
+        heapRemoveUser(heap, popped[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double removeNs = elapsedNs(t0, t1) / removals;
+
+    int mismatches = 0;
+    for (int i = 0; i < removals; i++) {
+        if (popped[i] != legacyPop(&legacy)) mismatches++;
+    }
+
+    printf("%10d users | build %6.1f / %6.1f ns | update %10.1f / %6.1f ns | remove-top %7.1f ns | order %s\n",
+           n, legacyBuild, newBuild, legacyUpdateNs, newUpdateNs, removeNs,
+           mismatches == 0 ? "match" : "MISMATCH");
+
+    free(popped);
+    free(who);
+    free(worth);
+    free(legacy.userArray);
+    /* The profiles are one calloc block, so detach them before freeHeap. */
+    heap->size = 0;
+    freeHeap(heap);
+    free(users);
+}
+
+int main(int argc, char** argv) {
+    int maxUsers = 1000000;
+    if (argc > 1) maxUsers = atoi(argv[1]);
+
+    printf("Legacy binary heap vs indexed %d-ary heap (legacy / new, per operation)\n", HEAP_ARITY);
+    for (int n = 10000; n > 0 && n <= maxUsers; n *= 10) {
+        runSize(n);
+    }
+    return 0;
+}
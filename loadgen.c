@@ -0,0 +1,444 @@
+#include "wealth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+/* Drives the engine with a deterministic mix of user activity, without the
+   menus. A run can be recorded to a trace and replayed later, so the same
+   workload can be timed against two builds. Engine time starts at a fixed
+   epoch kept in the trace header and only moves on clock ticks, so a
+   replay does exactly the same work. Per-operation latencies are
+   reported as percentiles, and resident memory is sampled as the user
+   population and logs grow. */
+
+typedef enum LoadOp {
+    OP_REGISTER,
+    OP_EXPENSE,
+    OP_INCOME,
+    OP_STOCK_BUY,
+    OP_REVALUE,
+    OP_FX_RATE,
+    OP_PORTFOLIO,
+    OP_PROJECTION,
+    OP_TOP_USERS,
+    OP_CLOCK_TICK,
+    OP_COUNT
+} LoadOp;
+
+static const char* g_opNames[OP_COUNT] = {
+    "register", "expense", "income", "stock buy", "revalue",
+    "fx rate", "portfolio", "projection", "top users", "clock tick"
+};
+
+/* Out of 1000; registrations come in bursts on top of this mix. */
+static const int g_opMix[OP_COUNT] = {0, 420, 80, 110, 90, 5, 100, 60, 50, 85};
+
+typedef struct TraceRecord {
+    int op;
+    int user;
+    int item;
+    double amount;
+    double price;
+} TraceRecord;
+
+#define TRACE_MAGIC "WLTHTRC2"
+#define DEFAULT_EPOCH 1704067200LL
+#define TICKER_COUNT 64
+#define FOREIGN_TICKERS 16
+#define BURST_CHANCE 4
+#define BURST_SIZE 250
+#define CLOCK_TICK_SECONDS (6 * 60 * 60)
+#define TOP_USERS_K 10
+
+static const char* g_categories[] = {"health", "travel", "education", "regular"};
+static const char* g_descriptions[] = {"groceries", "rent", "fuel", "pharmacy", "tuition", "flight", "hotel", "dining"};
+
+typedef struct LatencySeries {
+    long long* samples;
+    long count;
+    long capacity;
+    double totalNs;
+} LatencySeries;
+
+/* ---- Deterministic generator ---- */
+
+static unsigned long long g_rng;
+
+static unsigned long long nextRandom(void) {
+    g_rng ^= g_rng >> 12;
+    g_rng ^= g_rng << 25;
+    g_rng ^= g_rng >> 27;
+    return g_rng * 2685821657736338717ULL;
+}
+
+static double uniform(void) {
+    return (double)(nextRandom() >> 11) / 9007199254740992.0;
+}
+
+/* Approximate Zipf rank in [0, n) by inverting the continuous power law;
+   rank 0 is the most active. */
+static int zipfRank(int n, double s) {
+    if (n <= 1) return 0;
+    double u = uniform();
+    double a = 1.0 - s;
+    /* At s = 1 the power law's inverse degenerates to a logarithm. */
+    double x = fabs(a) < 1e-9 ? exp(u * log((double)n + 1.0))
+                              : pow((pow((double)n, a) - 1.0) * u + 1.0, 1.0 / a);
+    int rank = (int)x - 1;
+    return rank < 0 ? 0 : (rank >= n ? n - 1 : rank);
+}
+
+typedef struct Generator {
+    int targetUsers;
+    int registered;
+    int burstLeft;
+    double prices[TICKER_COUNT];
+    double usdRate;
+} Generator;
+
+static void initGenerator(Generator* g, int targetUsers) {
+    g->targetUsers = targetUsers;
+    g->registered = 0;
+    g->burstLeft = 0;
+    for (int i = 0; i < TICKER_COUNT; i++) g->prices[i] = 50.0 + (double)(nextRandom() % 300000) / 100.0;
+    g->usdRate = 83.0;
+}
+
+static TraceRecord generateOp(Generator* g) {
+    TraceRecord r;
+    memset(&r, 0, sizeof(r));
+
+    if (g->registered < g->targetUsers && g->burstLeft == 0 &&
+        (g->registered == 0 || (int)(nextRandom() % 1000) < BURST_CHANCE)) {
+        g->burstLeft = BURST_SIZE;
+    }
+    if (g->burstLeft > 0 && g->registered < g->targetUsers) {
+        g->burstLeft--;
+        r.op = OP_REGISTER;
+        r.user = g->registered++;
+        return r;
+    }
+    g->burstLeft = 0;
+
+    int pick = (int)(nextRandom() % 1000);
+    r.op = OP_EXPENSE;
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (pick < g_opMix[op]) {
+            r.op = op;
+            break;
+        }
+        pick -= g_opMix[op];
+    }
+    r.user = zipfRank(g->registered, 1.1);
+
+    switch (r.op) {
+        case OP_EXPENSE:
+            r.item = (int)(nextRandom() % 32);
+            r.amount = (double)(nextRandom() % 500000) / 100.0 + 10.0;
+            break;
+        case OP_INCOME:
+            r.amount = (double)(nextRandom() % 20000) * 10.0 + 1000.0;
+            break;
+        case OP_STOCK_BUY:
+        case OP_REVALUE: {
+            r.item = zipfRank(TICKER_COUNT, 1.0);
+            double* price = &g->prices[r.item];
+            *price *= 1.0 + (uniform() - 0.5) * 0.04;
+            r.price = *price;
+            r.amount = r.op == OP_STOCK_BUY ? (double)(nextRandom() % 50 + 1) : 0.0;
+            break;
+        }
+        case OP_FX_RATE:
+            g->usdRate *= 1.0 + (uniform() - 0.5) * 0.01;
+            r.price = g->usdRate;
+            break;
+        case OP_PROJECTION:
+            r.item = (int)(nextRandom() % 30) + 1;
+            break;
+        default:
+            break;
+    }
+    return r;
+}
+
+/* ---- Execution ---- */
+
+static UserProfile** g_users = NULL;
+static int g_userCount = 0;
+static int g_userCapacity = 0;
+static long g_skipped = 0;
+
+static void tickerName(int item, char* out, size_t size) {
+    snprintf(out, size, "%s%02d", item < FOREIGN_TICKERS ? "US" : "IN", item);
+}
+
+static void runOp(const TraceRecord* r) {
+    if (r->op == OP_REGISTER) {
+        char name[50];
+        snprintf(name, sizeof(name), "user%07d", r->user);
+        if (g_userCount >= g_userCapacity) {
+            int newCap = g_userCapacity ? g_userCapacity * 2 : 1024;
+            UserProfile** grown = (UserProfile**)realloc(g_users, sizeof(UserProfile*) * newCap);
+            if (grown == NULL) return;
+            g_users = grown;
+            g_userCapacity = newCap;
+        }
+        int before = g_userHeap->size;
+        registerNewUser(name);
+        if (g_userHeap->size > before) g_users[g_userCount++] = g_userHeap->userArray[g_userHeap->size - 1];
+        return;
+    }
+
+    UserProfile* user = (r->user >= 0 && r->user < g_userCount) ? g_users[r->user] : NULL;
+    char ticker[16];
+    switch (r->op) {
+        case OP_EXPENSE: {
+            if (user == NULL) break;
+            const char* category = g_categories[r->item % 4];
+            logExpenseToList(user, category, g_descriptions[r->item / 4], r->amount, INV_NONE);
+            updateExpenseCategoryTotal(user, category, r->amount);
+            finalizeUserUpdates(user);
+            return;
+        }
+        case OP_INCOME: {
+            WealthNode* salary = user ? findWealthNode(user->wealthTreeRoot, "salary") : NULL;
+            if (salary == NULL) break;
+            salary->value += r->amount;
+            finalizeUserUpdates(user);
+            return;
+        }
+        case OP_STOCK_BUY:
+            if (user == NULL) break;
+            tickerName(r->item, ticker, sizeof(ticker));
+            /* Prices are generated in rupees; foreign tickers are quoted in USD. */
+            if (r->item < FOREIGN_TICKERS) {
+                WealthNode* existing = findStockHolding(user, ticker);
+                double rate = g_fxCurrencies[fxFindCurrency("USD")].rate;
+                if (existing == NULL || existing->currencyId > 0) {
+                    buyStockLots(user, ticker, r->amount, r->price / rate, 0.0, "USD");
+                    return;
+                }
+            }
+            buyStockLots(user, ticker, r->amount, r->price, 0.0, NULL);
+            return;
+        case OP_REVALUE: {
+            if (user == NULL) break;
+            tickerName(r->item, ticker, sizeof(ticker));
+            WealthNode* holding = findStockHolding(user, ticker);
+            if (holding == NULL || holding->lots == NULL) break;
+            double price = holding->currencyId > 0 ? fxConvertFromBase(r->price, holding->currencyId) : r->price;
+            manageStockInCurrency(user, ticker, holding->lots->totalUnits * price, -1, 0, NULL);
+            return;
+        }
+        case OP_FX_RATE:
+            fxSetRate("USD", r->price);
+            return;
+        case OP_PORTFOLIO: {
+            if (user == NULL) break;
+            int count = 0;
+            PortfolioRow total;
+            free(buildPortfolio(user, &count, &total));
+            return;
+        }
+        case OP_PROJECTION:
+            if (user == NULL) break;
+            calculateProjectedNetWorth(user->wealthTreeRoot, r->item);
+            return;
+        case OP_TOP_USERS: {
+            UserProfile* top[TOP_USERS_K];
+            getTopWealthUser(g_userHeap);
+            heapTopK(g_userHeap, TOP_USERS_K, top);
+            return;
+        }
+        case OP_CLOCK_TICK:
+            advanceEngineClock(CLOCK_TICK_SECONDS);
+            runCompactionStep(g_userHeap, COMPACTION_STEP_BUDGET);
+            return;
+        default:
+            break;
+    }
+    g_skipped++;
+}
+
+/* ---- Measurement ---- */
+
+static void addSample(LatencySeries* s, long long ns) {
+    if (s->count >= s->capacity) {
+        long newCap = s->capacity ? s->capacity * 2 : 1024;
+        long long* grown = (long long*)realloc(s->samples, sizeof(long long) * newCap);
+        if (grown == NULL) return;
+        s->samples = grown;
+        s->capacity = newCap;
+    }
+    s->samples[s->count++] = ns;
+    s->totalNs += (double)ns;
+}
+
+static int compareSamples(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentileUs(const LatencySeries* s, double p) {
+    if (s->count == 0) return 0.0;
+    long index = (long)ceil(p * (double)s->count) - 1;
+    if (index < 0) index = 0;
+    if (index >= s->count) index = s->count - 1;
+    return (double)s->samples[index] / 1000.0;
+}
+
+static long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double residentMb(void) {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f == NULL) return 0.0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return (double)resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+static long totalLogEntries(void) {
+    long entries = 0;
+    for (int i = 0; i < g_userCount; i++) {
+        UserProfile* user = g_users[i];
+        if (user->coldLog) entries += user->coldLog->count;
+        for (ExpenditureNode* e = user->expenseListHead; e != NULL; e = e->next) entries++;
+    }
+    return entries;
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [--users N] [--ops N] [--seed N] [--sample-every N]\n"
+           "          [--record FILE | --replay FILE]\n", program);
+}
+
+int main(int argc, char** argv) {
+    int users = 100000;
+    long ops = 1000000;
+    long sampleEvery = 100000;
+    unsigned long long seed = 42;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value != NULL && strcmp(argv[i], "--users") == 0) users = atoi(argv[++i]);
+        else if (value != NULL && strcmp(argv[i], "--ops") == 0) ops = atol(argv[++i]);
+        else if (value != NULL && strcmp(argv[i], "--seed") == 0) seed = strtoull(argv[++i], NULL, 10);
+        else if (value != NULL && strcmp(argv[i], "--sample-every") == 0) sampleEvery = atol(argv[++i]);
+        else if (value != NULL && strcmp(argv[i], "--record") == 0) recordPath = argv[++i];
+        else if (value != NULL && strcmp(argv[i], "--replay") == 0) replayPath = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (users <= 0 || ops <= 0 || sampleEvery <= 0 || (recordPath && replayPath)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    FILE* trace = NULL;
+    long long epoch = DEFAULT_EPOCH;
+    if (replayPath != NULL) {
+        char magic[8];
+        trace = fopen(replayPath, "rb");
+        if (trace == NULL || fread(magic, 1, 8, trace) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+            fread(&epoch, sizeof(epoch), 1, trace) != 1 || epoch <= 0) {
+            printf("Error: '%s' is not a trace file.\n", replayPath);
+            if (trace) fclose(trace);
+            return 1;
+        }
+    } else if (recordPath != NULL) {
+        trace = fopen(recordPath, "wb");
+        if (trace == NULL || fwrite(TRACE_MAGIC, 1, 8, trace) != 8 || fwrite(&epoch, sizeof(epoch), 1, trace) != 1) {
+            printf("Error: Cannot write trace '%s'.\n", recordPath);
+            if (trace) fclose(trace);
+            return 1;
+        }
+    }
+
+    g_engineQuiet = 1;
+    setEngineEpoch((time_t)epoch);
+    g_rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+    g_userHeap = createHeap(1024);
+    if (g_userHeap == NULL) return 1;
+    fxSetRate("USD", 83.0);
+
+    Generator generator;
+    initGenerator(&generator, users);
+    LatencySeries latency[OP_COUNT];
+    memset(latency, 0, sizeof(latency));
+
+    printf("%s %ld operations%s%s\n", replayPath ? "Replaying" : "Generating", ops,
+           replayPath ? " from " : (recordPath ? ", recording to " : ""),
+           replayPath ? replayPath : (recordPath ? recordPath : ""));
+    printf("%12s %10s %12s %10s %12s %14s\n", "ops", "users", "log entries", "RSS MB", "KB/user", "window ops/s");
+
+    double startRss = residentMb();
+    long long start = nowNs();
+    long long windowStart = start;
+    long done = 0;
+    for (; done < ops; done++) {
+        TraceRecord r;
+        if (replayPath != NULL) {
+            if (fread(&r, sizeof(r), 1, trace) != 1) break;
+            if (r.op < 0 || r.op >= OP_COUNT) {
+                printf("Error: Corrupt trace record %ld.\n", done);
+                break;
+            }
+        } else {
+            r = generateOp(&generator);
+            if (trace != NULL && fwrite(&r, sizeof(r), 1, trace) != 1) {
+                printf("Error: Failed writing trace.\n");
+                break;
+            }
+        }
+
+        long long before = nowNs();
+        runOp(&r);
+        addSample(&latency[r.op], nowNs() - before);
+
+        if ((done + 1) % sampleEvery == 0) {
+            long long now = nowNs();
+            double rss = residentMb();
+            printf("%12ld %10d %12ld %10.1f %12.2f %14.0f\n", done + 1, g_userCount, totalLogEntries(), rss,
+                   g_userCount ? (rss - startRss) * 1024.0 / g_userCount : 0.0,
+                   (double)sampleEvery * 1e9 / (double)(now - windowStart));
+            windowStart = now;
+        }
+    }
+    double elapsed = (double)(nowNs() - start) / 1e9;
+    if (trace != NULL) fclose(trace);
+
+    printf("\n%ld operations in %.2f s (%.0f ops/s), %d users, %ld skipped (no such user or holding)\n",
+           done, elapsed, elapsed > 0 ? (double)done / elapsed : 0.0, g_userCount, g_skipped);
+    printf("%-12s %10s %12s %10s %10s %10s %10s\n", "operation", "count", "ops/s", "p50 us", "p99 us", "p999 us", "max us");
+    for (int op = 0; op < OP_COUNT; op++) {
+        LatencySeries* s = &latency[op];
+        if (s->count == 0) continue;
+        qsort(s->samples, (size_t)s->count, sizeof(long long), compareSamples);
+        printf("%-12s %10ld %12.0f %10.2f %10.2f %10.2f %10.2f\n", g_opNames[op], s->count,
+               s->totalNs > 0 ? (double)s->count * 1e9 / s->totalNs : 0.0,
+               percentileUs(s, 0.50), percentileUs(s, 0.99), percentileUs(s, 0.999),
+               (double)s->samples[s->count - 1] / 1000.0);
+        free(s->samples);
+    }
+    printf("Memory: %.1f MB resident at start, %.1f MB at end.\n", startRss, residentMb());
+
+    free(g_users);
+    freeHeap(g_userHeap);
+    fxFreeTables();
+    freeLotPool();
+    freeAlertPool();
+    freeColdLogDictionary();
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Lots live in fixed-size chunks carved from one growable pool, so a
+   holding's queue is a short chain of contiguous arrays. Chunks are linked
+   by pool index (the pool may move when it grows) and recycled through a
+   free list. Selling pops from the head and touches only the lots it
+   consumes. */
+static LotChunk* g_lotPool = NULL;
+static int g_lotPoolSize = 0;
+static int g_lotPoolCapacity = 0;
+static int g_freeChunk = -1;
+
+/* Makes sure the next `count` chunk allocations cannot fail. */
+static int reserveChunks(int count) {
+    if (g_lotPoolCapacity - g_lotPoolSize >= count) return 1;
+    int newCap = g_lotPoolCapacity ? g_lotPoolCapacity * 2 : 64;
+    while (newCap - g_lotPoolSize < count) newCap *= 2;
+    LotChunk* grown = (LotChunk*)realloc(g_lotPool, sizeof(LotChunk) * newCap);
+    if (grown == NULL) return 0;
+    g_lotPool = grown;
+    g_lotPoolCapacity = newCap;
+    return 1;
+}
+
+static int allocChunk(void) {
+    int index;
+    if (g_freeChunk != -1) {
+        index = g_freeChunk;
+        g_freeChunk = g_lotPool[index].next;
+    } else {
+        if (!reserveChunks(1)) return -1;
+        index = g_lotPoolSize++;
+    }
+    g_lotPool[index].next = -1;
+    return index;
+}
+
+static void releaseChunk(int index) {
+    g_lotPool[index].next = g_freeChunk;
+    g_freeChunk = index;
+}
+
+static LotQueue* createLotQueue(void) {
+    LotQueue* q = (LotQueue*)calloc(1, sizeof(LotQueue));
+    if (q == NULL) return NULL;
+    q->headChunk = q->tailChunk = -1;
+    q->method = COST_FIFO;
+    return q;
+}
+
+static LotQueue* getLotQueue(WealthNode* node) {
+    if (node->lots == NULL) node->lots = createLotQueue();
+    return node->lots;
+}
+
+static int pushLot(LotQueue* q, double units, double unitCost, time_t date) {
+    if (q->tailChunk == -1 || q->tailCount == LOT_CHUNK_SIZE) {
+        int chunk = allocChunk();
+        if (chunk == -1) return 0;
+        if (q->tailChunk == -1) {
+            q->headChunk = chunk;
+            q->headPos = 0;
+        } else {
+            g_lotPool[q->tailChunk].next = chunk;
+        }
+        q->tailChunk = chunk;
+        q->tailCount = 0;
+    }
+    Lot* lot = &g_lotPool[q->tailChunk].lots[q->tailCount++];
+    lot->units = units;
+    lot->unitCost = unitCost;
+    lot->date = date;
+    q->lotCount++;
+    q->totalUnits += units;
+    q->totalCost += units * unitCost;
+    return 1;
+}
+
+/* Removes `units` from the front of the queue and returns the FIFO cost of
+   what was removed. */
+static double consumeLots(LotQueue* q, double units) {
+    double cost = 0.0;
+    while (units > 0.0 && q->headChunk != -1) {
+        LotChunk* chunk = &g_lotPool[q->headChunk];
+        int end = (q->headChunk == q->tailChunk) ? q->tailCount : LOT_CHUNK_SIZE;
+        Lot* lot = &chunk->lots[q->headPos];
+        double take = lot->units < units ? lot->units : units;
+        cost += take * lot->unitCost;
+        lot->units -= take;
+        units -= take;
+        if (lot->units > LOT_UNIT_EPSILON) break;
+
+        q->lotCount--;
+        if (++q->headPos < end) continue;
+        int next = chunk->next;
+        releaseChunk(q->headChunk);
+        q->headChunk = next;
+        q->headPos = 0;
+        if (next == -1) q->tailChunk = -1;
+    }
+    return cost;
+}
+
+int buyStockLots(UserProfile* user, const char* ticker, double units, double price, double rate, const char* currency) {
+    if (user == NULL || ticker == NULL || units <= 0 || price < 0) return 0;
+
+    /* Value the holding already carries without shares behind it becomes an
+       opening lot at this purchase's price, costed at the value it was
+       carried at, so a later sale does not mark it away. */
+    WealthNode* node = findStockHolding(user, ticker);
+    double openingNative = 0.0;
+    double openingCost = 0.0;
+    if (node != NULL && node->value != 0.0 && (node->lots == NULL || node->lots->totalUnits <= LOT_UNIT_EPSILON)) {
+        if (node->value < 0.0 || price <= 0.0) {
+            printf("Error: '%s' has a value of Rs.%.2f with no shares recorded; cannot open lots at this price.\n",
+                   node->name, node->value);
+            return 0;
+        }
+        openingNative = fxHoldingNativeValue(node);
+        openingCost = node->value;
+    }
+
+    /* Everything the lots need is allocated before the value changes, so a
+       purchase is never recorded in the holding without its lot. At most
+       two lots are pushed, and each needs at most one new chunk. */
+    LotQueue* fresh = NULL;
+    if (node == NULL || node->lots == NULL) {
+        fresh = createLotQueue();
+        if (fresh == NULL) return 0;
+    }
+    if (!reserveChunks(2) || !manageStockInCurrency(user, ticker, units * price, rate, 1, currency)) {
+        free(fresh);
+        return 0;
+    }
+    node = findStockHolding(user, ticker);
+    if (node->lots == NULL) {
+        node->lots = fresh;
+    } else {
+        free(fresh);
+    }
+    LotQueue* q = node->lots;
+    if (openingNative > 0.0) {
+        double openingUnits = openingNative / price;
+        pushLot(q, openingUnits, openingCost / openingUnits, engineNow());
+    }
+
+    double baseCost = fxConvertToBase(units * price, node->currencyId);
+    pushLot(q, units, baseCost / units, engineNow());
+    logExpenseToList(user, "investment", node->name, baseCost, INV_STOCKS);
+    return 1;
+}
+
+int sellStockLots(UserProfile* user, const char* ticker, double units, double price, double* realizedOut) {
+    WealthNode* node = findStockHolding(user, ticker);
+    if (node == NULL || node->lots == NULL || node->lots->totalUnits <= 0) {
+        printf("Error: No share lots recorded for '%s'.\n", ticker);
+        return 0;
+    }
+    LotQueue* q = node->lots;
+    if (units <= 0 || units > q->totalUnits + LOT_UNIT_EPSILON) {
+        printf("Error: You hold %.4f shares of '%s'.\n", q->totalUnits, node->name);
+        return 0;
+    }
+    if (units > q->totalUnits) units = q->totalUnits;
+
+    double proceeds = fxConvertToBase(units * price, node->currencyId);
+    double fifoCost = consumeLots(q, units);
+    double costRelieved = fifoCost;
+    if (q->method == COST_AVERAGE) costRelieved = units * (q->totalCost / q->totalUnits);
+
+    q->totalUnits -= units;
+    q->totalCost -= costRelieved;
+    if (q->totalUnits <= LOT_UNIT_EPSILON || q->lotCount == 0) {
+        q->totalUnits = 0.0;
+        q->totalCost = 0.0;
+    }
+    double realized = proceeds - costRelieved;
+    q->realizedGain += realized;
+    if (realizedOut != NULL) *realizedOut = realized;
+
+    /* Remaining shares are marked at the sale price; the proceeds land in a
+       cash holding so the sale itself does not change net worth. */
+    beginUpdateBatch();
+    manageStockInCurrency(user, node->name, q->totalUnits * price, -1, 0, NULL);
+    manageAsset(user, "cash", proceeds, -1, 1);
+    endUpdateBatch();
+    logExpenseToList(user, "sale", node->name, proceeds, INV_NONE);
+    return 1;
+}
+
+void setHoldingCostMethod(WealthNode* node, CostMethod method) {
+    if (node == NULL || node->lots == NULL || node->lots->method == method) return;
+    LotQueue* q = node->lots;
+    /* Average cost does not maintain per-lot costs, so restate the open
+       lots at the average before FIFO starts reading them again. */
+    if (q->method == COST_AVERAGE && method == COST_FIFO && q->totalUnits > 0) {
+        double average = q->totalCost / q->totalUnits;
+        for (int c = q->headChunk; c != -1; c = g_lotPool[c].next) {
+            int start = (c == q->headChunk) ? q->headPos : 0;
+            int end = (c == q->tailChunk) ? q->tailCount : LOT_CHUNK_SIZE;
+            for (int i = start; i < end; i++) g_lotPool[c].lots[i].unitCost = average;
+        }
+    }
+    q->method = method;
+}
+
+void openLotCursor(LotCursor* cursor, const LotQueue* q) {
+    cursor->queue = q;
+    cursor->chunk = q ? q->headChunk : -1;
+    cursor->pos = q ? q->headPos : 0;
+}
+
+const Lot* nextLot(LotCursor* cursor) {
+    while (cursor->chunk != -1) {
+        const LotQueue* q = cursor->queue;
+        int end = (cursor->chunk == q->tailChunk) ? q->tailCount : LOT_CHUNK_SIZE;
+        if (cursor->pos < end) return &g_lotPool[cursor->chunk].lots[cursor->pos++];
+        cursor->chunk = (cursor->chunk == q->tailChunk) ? -1 : g_lotPool[cursor->chunk].next;
+        cursor->pos = 0;
+    }
+    return NULL;
+}
+
+/* Appends a lot as-is, without touching the holding's value or the log;
+   used when reloading a snapshot. Zero units only creates the queue. */
+int restoreLot(WealthNode* node, double units, double unitCost, time_t date) {
+    if (node == NULL) return 0;
+    LotQueue* q = getLotQueue(node);
+    if (q == NULL) return 0;
+    return units <= 0 || pushLot(q, units, unitCost, date);
+}
+
+void freeLotQueue(LotQueue* q) {
+    if (q == NULL) return;
+    int chunk = q->headChunk;
+    while (chunk != -1) {
+        int next = g_lotPool[chunk].next;
+        releaseChunk(chunk);
+        chunk = next;
+    }
+    free(q);
+}
+
+void freeLotPool(void) {
+    free(g_lotPool);
+    g_lotPool = NULL;
+    g_lotPoolSize = g_lotPoolCapacity = 0;
+    g_freeChunk = -1;
+}
@@ -6,7 +6,12 @@
 
 void getStringInput(const char* prompt, char* buffer, int size) {
     printf("%s", prompt);
-    if (fgets(buffer, size, stdin) == NULL) {
+    fflush(stdout);
+    /* The autosave thread may snapshot the engine while we wait here. */
+    unlockEngine();
+    char* line = fgets(buffer, size, stdin);
+    lockEngine();
+    if (line == NULL) {
         buffer[0] = '\0';
         return;
     }
@@ -65,6 +70,7 @@ void handleAddTransaction(UserProfile* user) {
 
     char category[50];
     char description[100];
+    char currency[10] = "";
     double amount;
     double interestRate = 0.0;
     InvestmentType invType = INV_NONE;
@@ -103,6 +109,7 @@ void handleAddTransaction(UserProfile* user) {
         }
         if (invType == INV_STOCKS) {
             getStringInput("Enter Stock Name/Ticker (e.g., AAPL): ", description, 100);
+            getStringInput("Enter currency code [" FX_BASE_CURRENCY " or current]: ", currency, 10);
         } else {
             getStringInput("Enter description: ", description, 100);
         }
@@ -115,18 +122,25 @@ void handleAddTransaction(UserProfile* user) {
 
     if (strlen(description) == 0) { printf("Error: Description cannot be empty.\n"); return; }
 
+    if (invType == INV_STOCKS) {
+        double units = getDoubleInput("Enter number of shares: ");
+        if (units <= 0) { printf("Error: Number of shares must be positive.\n"); return; }
+        double price = getDoubleInput("Enter price per share: ");
+        if (price <= 0) { printf("Error: Price must be positive.\n"); return; }
+        /* Each purchase opens a tax lot; cost is kept in rupees at the rate paid. */
+        if (!buyStockLots(user, description, units, price, interestRate, currency)) return;
+        printf("Transaction logged successfully. New net worth: Rs.%.2f\n", user->netWorth);
+        return;
+    }
+
     amount = getDoubleInput("Enter amount: ");
     if (amount <= 0) { printf("Error: Amount must be positive.\n"); return; }
 
     logExpenseToList(user, category, description, amount, invType);
 
     if (strcmp(category, "investment") == 0) {
-        if (invType == INV_STOCKS) {
-            manageStock(user, description, amount, interestRate, 1); 
-        } else {
-            const char* assetName = getInvestmentNodeName(invType);
-            manageAsset(user, assetName, amount, interestRate, 1);
-        }
+        const char* assetName = getInvestmentNodeName(invType);
+        manageAsset(user, assetName, amount, interestRate, 1);
     } else {
         updateExpenseCategoryTotal(user, category, amount);
         finalizeUserUpdates(user);
@@ -157,6 +171,7 @@ void handleUpdateInvestment(UserProfile* user) {
     int choice = getIntInput("Enter choice: ");
 
     char nodeName[50];
+    char currency[10];
     double value, rate;
 
     if (choice == 1) {
@@ -167,7 +182,9 @@ void handleUpdateInvestment(UserProfile* user) {
         printf("Current Interest Rate (%%): ");
         rate = getDoubleInput("");
         
-        manageStock(user, nodeName, value, rate, 0);
+        getStringInput("Currency code [keep current]: ", currency, 10);
+        
+        manageStockInCurrency(user, nodeName, value, rate, 0, currency);
 
     } else if (choice == 2) {
         printf("Asset nodes: gold, real estate, others\n");
@@ -177,7 +194,9 @@ void handleUpdateInvestment(UserProfile* user) {
         printf("Current Interest Rate (%%): ");
         rate = getDoubleInput("");
 
-        manageAsset(user, nodeName, value, rate, 0);
+        getStringInput("Currency code [keep current]: ", currency, 10);
+
+        manageAssetInCurrency(user, nodeName, value, rate, 0, currency);
     } else {
         printf("Invalid choice.\n");
     }
@@ -199,16 +218,9 @@ void handleProjectedWealth(UserProfile* user) {
     printf("Estimated Growth:    Rs.%.2f\n", projected - user->netWorth);
 }
 
-double getCostBasis(UserProfile* user, const char* name) {
-    double total = 0.0;
-    ExpenditureNode* current = user->expenseListHead;
-    while (current != NULL) {
-        if (strcicmp(current->description, name) == 0) {
-            total += current->amount;
-        }
-        current = current->next;
-    }
-    return total;
+void printPortfolioRow(const char* name, double cost, double market, double realized) {
+    printf(" %-20s | Rs.%-9.2f | Rs.%-9.2f | Rs.%-9.2f | Rs.%-8.2f\n",
+           name, cost, market, market - cost, realized);
 }
 
 void handleViewInvestmentPortfolio(UserProfile* user) {
@@ -217,68 +229,58 @@ void handleViewInvestmentPortfolio(UserProfile* user) {
         return;
     }
 
-    printf("\n==========================================================================\n");
-    printf(" %-20s | %-12s | %-12s | %-10s\n", "Asset", "Cost Basis", "Market Value", "Gain/Loss");
-    printf("==========================================================================\n");
-
-    double totalCost = 0.0;
-    double totalValue = 0.0;
-
-    WealthNode* invRoot = findWealthNode(user->wealthTreeRoot, "Investments");
-    if (invRoot) {
-        WealthNode* stockCat = findWealthNode(invRoot, "stock");
-        if (stockCat) {
-            WealthNode* child = stockCat->firstChild;
-            if (child == NULL) {
-            } else {
-                printf(" [STOCKS]\n");
-                while (child != NULL) {
-                    double cost = getCostBasis(user, child->name);
-                    double market = child->value;
-                    double diff = market - cost;
-                    
-                    printf(" %-20s | Rs.%-9.2f | Rs.%-9.2f | Rs.%-8.2f\n", 
-                           child->name, cost, market, diff);
-                    
-                    totalCost += cost;
-                    totalValue += market;
-                    child = child->nextSibling;
-                }
-            }
+    printf("\n=========================================================================================\n");
+    printf(" %-20s | %-12s | %-12s | %-12s | %-10s\n", "Asset", "Cost Basis", "Market Value", "Unrealized", "Realized");
+    printf("=========================================================================================\n");
+
+    int count = 0;
+    PortfolioRow total;
+    PortfolioRow* rows = buildPortfolio(user, &count, &total);
+    for (int i = 0; i < count; i++) {
+        PortfolioRow* row = &rows[i];
+        if (i == 0 && row->isStock) printf(" [STOCKS]\n");
+        if (!row->isStock && (i == 0 || rows[i - 1].isStock)) printf(" [GENERAL]\n");
+
+        printPortfolioRow(row->name, row->cost, row->market, row->realized);
+        const LotQueue* lots = row->holding->lots;
+        if (row->isStock && lots && lots->totalUnits > 0) {
+            printf("   %.4f shares in %d lot(s), %s\n", lots->totalUnits, lots->lotCount,
+                   lots->method == COST_AVERAGE ? "average cost" : "FIFO");
         }
+    }
+    free(rows);
 
-        const char* generics[] = {"gold", "real estate", "others"};
-        printf(" [GENERAL]\n");
-        for (int i = 0; i < 3; i++) {
-            WealthNode* node = findWealthNode(invRoot, generics[i]);
-            if (node) {
-                double cost = 0.0;
-                ExpenditureNode* curr = user->expenseListHead;
-                InvestmentType targetType = INV_NONE;
-                if (strcmp(generics[i], "gold")==0) targetType = INV_GOLD;
-                if (strcmp(generics[i], "real estate")==0) targetType = INV_PROPERTY;
-                if (strcmp(generics[i], "others")==0) targetType = INV_OTHERS;
-
-                while(curr) {
-                    if (curr->investmentType == targetType) cost += curr->amount;
-                    curr = curr->next;
-                }
+    printf("-----------------------------------------------------------------------------------------\n");
+    printPortfolioRow("TOTAL", total.cost, total.market, total.realized);
+    printf("=========================================================================================\n");
+}
 
-                double market = node->value;
-                double diff = market - cost;
-                 printf(" %-20s | Rs.%-9.2f | Rs.%-9.2f | Rs.%-8.2f\n", 
-                           generics[i], cost, market, diff);
-                
-                totalCost += cost;
-                totalValue += market;
-            }
-        }
-    }
+void handleSellStock(UserProfile* user) {
+    if (user == NULL) return;
 
-    printf("--------------------------------------------------------------------------\n");
-    printf(" %-20s | Rs.%-9.2f | Rs.%-9.2f | Rs.%-8.2f\n", 
-           "TOTAL", totalCost, totalValue, totalValue - totalCost);
-    printf("==========================================================================\n");
+    char ticker[50];
+    char method[10];
+    printf("\n--- Sell Stock ---\n");
+    getStringInput("Enter Stock Name/Ticker: ", ticker, 50);
+    WealthNode* node = findStockHolding(user, ticker);
+    if (node == NULL || node->lots == NULL || node->lots->totalUnits <= 0) {
+        printf("Error: No share lots recorded for '%s'.\n", ticker);
+        return;
+    }
+    printf("You hold %.4f shares (%s).\n", node->lots->totalUnits,
+           node->lots->method == COST_AVERAGE ? "average cost" : "FIFO");
+    getStringInput("Cost method [1 = FIFO, 2 = Average, Enter = keep]: ", method, 10);
+    if (method[0] == '1') setHoldingCostMethod(node, COST_FIFO);
+    if (method[0] == '2') setHoldingCostMethod(node, COST_AVERAGE);
+
+    double units = getDoubleInput("Enter number of shares to sell: ");
+    double price = getDoubleInput("Enter sale price per share: ");
+    if (units <= 0 || price <= 0) { printf("Error: Shares and price must be positive.\n"); return; }
+
+    double realized = 0.0;
+    if (!sellStockLots(user, node->name, units, price, &realized)) return;
+    printf("Sold %.4f shares of %s. Realized gain: Rs.%.2f. New net worth: Rs.%.2f\n",
+           units, node->name, realized, user->netWorth);
 }
 
 void handleRegister() {
@@ -321,13 +323,100 @@ UserProfile* handleLogin() {
     return NULL;
 }
 
+void handleRemoveUser() {
+    if (g_userHeap == NULL || g_userHeap->size == 0) { printf("\nNo users.\n"); return; }
+    char name[50];
+    printf("\n--- Remove User ---\n");
+    getStringInput("Enter name: ", name, 50);
+    if (strlen(name) == 0) return;
+    for (int i = 0; i < g_userHeap->size; i++) {
+        if (g_userHeap->userArray[i] != NULL && strcicmp(g_userHeap->userArray[i]->name, name) == 0) {
+            unregisterUser(g_userHeap->userArray[i]);
+            printf("User '%s' removed.\n", name);
+            return;
+        }
+    }
+    printf("Error: User not found.\n");
+}
+
+void handleDisplayUsers() {
+    char currency[10];
+    getStringInput("Report currency [" FX_BASE_CURRENCY "]: ", currency, 10);
+    int currencyId = 0;
+    if (currency[0] != '\0') {
+        currencyId = fxFindCurrency(currency);
+        if (currencyId == -1) { printf("Error: Unknown currency '%s'.\n", currency); return; }
+    }
+    displayHeapInCurrency(g_userHeap, currencyId);
+}
+
+void handleUpdateFxRate() {
+    char currency[10];
+    printf("\n--- Update FX Rate ---\n");
+    getStringInput("Enter currency code (e.g., USD): ", currency, 10);
+    if (strlen(currency) == 0) { printf("Error: Currency cannot be empty.\n"); return; }
+    printf("Rs. per 1 %s: ", currency);
+    double rate = getDoubleInput("");
+    if (rate <= 0) { printf("Error: Rate must be positive.\n"); return; }
+    if (fxSetRate(currency, rate) == -1) { printf("Error: Could not set rate for '%s'.\n", currency); return; }
+    printf("Rate for %s set to Rs.%.4f. Holdings revalued.\n", fxCurrencyCode(fxFindCurrency(currency)), rate);
+}
+
+void handleAdvanceClock() {
+    printf("\n--- Advance Simulated Time ---\n");
+    int days = getIntInput("Enter number of days to advance: ");
+    if (days <= 0) { printf("Days must be positive.\n"); return; }
+    int fired = advanceEngineClock((long)days * 24 * 60 * 60);
+    time_t now = engineNow();
+    char* timeStr = ctime(&now);
+    timeStr[strcspn(timeStr, "\n")] = 0;
+    printf("Clock is now %s. %d scheduled transaction(s) applied.\n", timeStr, fired);
+}
+
+SeriesField getSeriesFieldInput() {
+    printf("  1. Net Worth\n  2. Income\n  3. Expenses\n  4. Investments\n");
+    switch (getIntInput("Enter series (1-4): ")) {
+        case 2: return SERIES_INCOME;
+        case 3: return SERIES_EXPENSES;
+        case 4: return SERIES_INVESTMENTS;
+        default: return SERIES_NET_WORTH;
+    }
+}
+
+void printSeriesBuckets(SeriesBucket* buckets, int count, SeriesBucketSize size) {
+    printf("\n %-12s | %-14s | %-14s | %-14s\n", "Period", "Min", "Max", "Last");
+    printf("--------------------------------------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        char period[16];
+        strftime(period, sizeof(period), size == BUCKET_MONTHLY ? "%Y-%m" : "%Y-%m-%d", localtime(&buckets[i].start));
+        printf(" %-12s | Rs.%-11.2f | Rs.%-11.2f | Rs.%-11.2f\n", period, buckets[i].min, buckets[i].max, buckets[i].last);
+    }
+}
+
+void handleSystemTrend() {
+    printf("\n--- System Net Worth Trend (monthly, last 12 months) ---\n");
+    SeriesField field = getSeriesFieldInput();
+    SeriesBucket buckets[13];
+    time_t now = engineNow();
+    int count = querySeriesDownsampledAll(g_userHeap, field, now - 365L * 24 * 60 * 60, now,
+                                          BUCKET_MONTHLY, buckets, 13);
+    printSeriesBuckets(buckets, count, BUCKET_MONTHLY);
+    printf("(Last is the sum of every user's latest value; Min/Max bound the total.)\n");
+}
+
 void adminMenu() {
     int choice = 0;
-    while (choice != 3) {
+    while (choice != 8) {
+        runDueSchedules(engineNow());
         printf("\n--- Admin Menu ---\n");
         printf("1. View Top Wealthiest User\n");
         printf("2. Display All Users\n");
-        printf("3. Logout\n");
+        printf("3. Remove User\n");
+        printf("4. Update FX Rate\n");
+        printf("5. Advance Simulated Time\n");
+        printf("6. System Net Worth Trend\n");
+        printf("7. Transaction Storage Report\n");
+        printf("8. Logout\n");
         choice = getIntInput("Enter your choice: ");
         switch (choice) {
             case 1: {
@@ -336,18 +425,185 @@ void adminMenu() {
                 else printf("\nNo users.\n");
                 break;
             }
-            case 2: displayHeap(g_userHeap); break;
-            case 3: printf("Logging out admin...\n"); break;
+            case 2: handleDisplayUsers(); break;
+            case 3: handleRemoveUser(); break;
+            case 4: handleUpdateFxRate(); break;
+            case 5: handleAdvanceClock(); break;
+            case 6: handleSystemTrend(); break;
+            case 7: printColdStorageReport(g_userHeap); break;
+            case 8: printf("Logging out admin...\n"); break;
             default: printf("Invalid choice.\n");
         }
     }
 }
 
+ScheduleInterval getIntervalInput() {
+    printf("  1. Weekly\n  2. Monthly\n  3. Quarterly\n");
+    switch (getIntInput("Enter frequency (1-3): ")) {
+        case 1: return EVERY_WEEK;
+        case 3: return EVERY_QUARTER;
+        default: return EVERY_MONTH;
+    }
+}
+
+void handleRecurringSchedules(UserProfile* user) {
+    if (user == NULL) return;
+
+    printf("\n--- Recurring Schedules ---\n");
+    printf("1. Add Salary Credit\n");
+    printf("2. Add Stock SIP\n");
+    printf("3. Add Recurring Expense (Rent, EMI, Premium)\n");
+    printf("4. View Schedules\n");
+    printf("5. Cancel Schedule\n");
+    int choice = getIntInput("Enter choice: ");
+
+    char target[50] = "";
+    char description[100] = "";
+    ScheduleKind kind;
+
+    switch (choice) {
+        case 1: kind = SCHED_INCOME; break;
+        case 2:
+            kind = SCHED_STOCK_SIP;
+            getStringInput("Enter Stock Name/Ticker: ", target, 50);
+            break;
+        case 3: {
+            kind = SCHED_EXPENSE;
+            printf("  1. Health\n  2. Travel\n  3. Education\n  4. Regular\n");
+            const char* categories[] = {"health", "travel", "education", "regular"};
+            int cat = getIntInput("Enter category (1-4): ");
+            if (cat < 1 || cat > 4) { printf("Invalid category choice.\n"); return; }
+            strcpy(target, categories[cat - 1]);
+            getStringInput("Enter description: ", description, 100);
+            break;
+        }
+        case 4: printUserSchedules(user); return;
+        case 5: {
+            printUserSchedules(user);
+            if (user->scheduleListHead == NULL) return;
+            int index = getIntInput("Enter schedule number to cancel: ");
+            RecurringSchedule* s = user->scheduleListHead;
+            for (int i = 1; s != NULL && i < index; i++) s = s->userNext;
+            if (index < 1 || s == NULL) { printf("Invalid schedule number.\n"); return; }
+            cancelRecurringSchedule(s);
+            printf("Schedule cancelled.\n");
+            return;
+        }
+        default: printf("Invalid choice.\n"); return;
+    }
+
+    if (kind == SCHED_STOCK_SIP && strlen(target) == 0) { printf("Error: Ticker cannot be empty.\n"); return; }
+    if (kind == SCHED_STOCK_SIP) {
+        WealthNode* held = findStockHolding(user, target);
+        if (held == NULL || held->lots == NULL || held->lots->totalUnits <= LOT_UNIT_EPSILON) {
+            printf("Error: Buy some shares of '%s' first; the SIP buys at their last marked price.\n", target);
+            return;
+        }
+    }
+    ScheduleInterval interval = getIntervalInput();
+    double amount = getDoubleInput("Enter amount: ");
+    if (amount <= 0) { printf("Error: Amount must be positive.\n"); return; }
+    int days = getIntInput("Days until first payment (0 = today): ");
+    if (days < 0) { printf("Days cannot be negative.\n"); return; }
+
+    time_t firstDue = engineNow() + (time_t)days * 24 * 60 * 60;
+    if (addRecurringSchedule(user, kind, interval, target, description, amount, firstDue) == NULL) {
+        printf("Error: Could not create schedule.\n");
+        return;
+    }
+    printf("Schedule added.\n");
+}
+
+void handleNetWorthHistory(UserProfile* user) {
+    if (user == NULL) return;
+    if (user->history == NULL) { printf("No history recorded yet.\n"); return; }
+
+    printf("\n--- Net Worth History ---\n");
+    SeriesField field = getSeriesFieldInput();
+    printf("  1. Daily (last 30 days)\n  2. Monthly (all time)\n");
+    SeriesBucketSize size = getIntInput("Enter resolution (1-2): ") == 1 ? BUCKET_DAILY : BUCKET_MONTHLY;
+
+    time_t now = engineNow();
+    time_t from = seriesFirstTime(user);
+    int maxBuckets = 240;
+    if (size == BUCKET_DAILY) {
+        maxBuckets = 31;
+        if (from < now - 30L * 24 * 60 * 60) from = now - 30L * 24 * 60 * 60;
+    }
+    SeriesBucket* buckets = (SeriesBucket*)malloc(sizeof(SeriesBucket) * maxBuckets);
+    if (buckets == NULL) return;
+    int count = querySeriesDownsampled(user, field, from, now, size, buckets, maxBuckets);
+    printSeriesBuckets(buckets, count, size);
+    free(buckets);
+
+    size_t bytes = seriesMemoryUsage(user->history);
+    printf("%lld samples stored in %zu bytes (%.1f bytes/sample).\n", user->history->pointCount, bytes,
+           (double)bytes / (double)user->history->pointCount);
+}
+
+void handleAlerts(UserProfile* user) {
+    if (user == NULL) return;
+
+    printf("\n--- Alerts ---\n");
+    printf("1. Alert When Monthly Category Spending Exceeds Amount\n");
+    printf("2. Alert On Single Expense Above Amount\n");
+    printf("3. Alert When Net Worth Drops By Percent\n");
+    printf("4. View Alert Rules\n");
+    printf("5. Remove Alert Rule\n");
+    printf("6. View Alert Inbox\n");
+    int choice = getIntInput("Enter choice: ");
+
+    const char* categories[] = {"health", "travel", "education", "regular"};
+    const char* category = NULL;
+    AlertKind kind;
+    double threshold;
+
+    switch (choice) {
+        case 1:
+        case 2: {
+            kind = (choice == 1) ? ALERT_MONTHLY_SPEND_ABOVE : ALERT_SINGLE_EXPENSE_ABOVE;
+            printf("  1. Health\n  2. Travel\n  3. Education\n  4. Regular\n");
+            int cat = getIntInput("Enter category (1-4): ");
+            if (cat < 1 || cat > 4) { printf("Invalid category choice.\n"); return; }
+            category = categories[cat - 1];
+            threshold = getDoubleInput("Enter amount: ");
+            break;
+        }
+        case 3:
+            kind = ALERT_NET_WORTH_DROP;
+            threshold = getDoubleInput("Enter drop percentage (0-100): ");
+            break;
+        case 4: printUserAlertRules(user); return;
+        case 5: {
+            printUserAlertRules(user);
+            if (user->firstAlertRule == -1) return;
+            int index = getIntInput("Enter rule number to remove: ");
+            if (!removeAlertRule(user, index)) { printf("Invalid rule number.\n"); return; }
+            printf("Alert rule removed.\n");
+            return;
+        }
+        case 6: printAlertInbox(user); return;
+        default: printf("Invalid choice.\n"); return;
+    }
+
+    if (addAlertRule(user, kind, category, threshold) == -1) {
+        printf("Error: Could not add alert rule. Check the amount.\n");
+        return;
+    }
+    printf("Alert rule added.\n");
+}
+
 void loggedInMenu(UserProfile* user) {
     if (user == NULL) return;
     int choice = 0;
-    while (choice != 9) { 
+    while (choice != 12) { 
+        runDueSchedules(engineNow());
+        runCompactionStep(g_userHeap, COMPACTION_STEP_BUDGET);
+        user->lastAccess = engineNow();
         printf("\n--- Welcome, %s (Net Worth: Rs.%.2f) ---\n", user->name, user->netWorth);
+        if (user->alertInbox != NULL && user->alertInbox->unread > 0) {
+            printf("You have %d new alert(s). Choose 11 to view them.\n", user->alertInbox->unread);
+        }
         printf("1. Add Transaction\n");
         printf("2. Add Income\n"); 
         printf("3. Update Investment Market Value\n");
@@ -355,20 +611,31 @@ void loggedInMenu(UserProfile* user) {
         printf("5. View Wealth Tree\n");
         printf("6. View Investment Portfolio\n");
         printf("7. View Projected Net Worth (Prediction)\n"); 
-        printf("8. Logout\n");
+        printf("8. Recurring Schedules\n");
+        printf("9. View Net Worth History\n");
+        printf("10. Sell Stock\n");
+        printf("11. Alerts\n");
+        printf("12. Logout\n");
         choice = getIntInput("Enter your choice: ");
         switch (choice) {
             case 1: handleAddTransaction(user); break;
             case 2: handleAddIncome(user); break;
             case 3: handleUpdateInvestment(user); break;
-            case 4: printExpenseLog(user->expenseListHead); break;
+            case 4:
+                printExpenseLog(user);
+                printExpenseRollups(user->rollupListHead);
+                break;
             case 5: 
                 printf("\n--- %s's Wealth Tree ---\n", user->name);
                 printWealthTree(user->wealthTreeRoot, 0); 
                 break;
             case 6: handleViewInvestmentPortfolio(user); break;
             case 7: handleProjectedWealth(user); break; 
-            case 8: printf("Logging out...\n"); return; 
+            case 8: handleRecurringSchedules(user); break;
+            case 9: handleNetWorthHistory(user); break;
+            case 10: handleSellStock(user); break;
+            case 11: handleAlerts(user); break;
+            case 12: printf("Logging out...\n"); return; 
             default: printf("Invalid choice.\n");
         }
     }
@@ -377,9 +644,28 @@ void loggedInMenu(UserProfile* user) {
 int main() {
     g_userHeap = createHeap(100);
     if (!g_userHeap) return 1;
+    lockEngine();
+    int loaded = loadSnapshot(SNAPSHOT_DEFAULT_PATH);
+    if (loaded < 0) {
+        /* Carrying on would overwrite the file with whatever was read. */
+        printf("Error: Could not read '%s'. Move it aside to start with no users.\n", SNAPSHOT_DEFAULT_PATH);
+        unlockEngine();
+        freeHeap(g_userHeap);
+        fxFreeTables();
+        freeLotPool();
+        freeAlertPool();
+        freeColdLogDictionary();
+        return 1;
+    }
+    if (loaded > 0) printf("Restored %d user(s) from '%s'.\n", loaded, SNAPSHOT_DEFAULT_PATH);
+    if (!startAutosave(SNAPSHOT_DEFAULT_PATH, AUTOSAVE_INTERVAL_SECONDS)) {
+        printf("Warning: Autosave is off; data is saved on exit only.\n");
+    }
     printf("Welcome to the Personal Wealth Management System!\n");
     int choice = 0;
     while (choice != 3) {
+        runDueSchedules(engineNow());
+        runCompactionStep(g_userHeap, COMPACTION_STEP_BUDGET);
         printf("\n--- Main Menu ---\n");
         printf("1. Register New User\n2. Login\n3. Exit\n");
         choice = getIntInput("Enter your choice: ");
@@ -397,7 +683,14 @@ int main() {
             default: printf("Invalid choice.\n");
         }
     }
+    unlockEngine();
+    stopAutosave();
+    if (!saveSnapshot(SNAPSHOT_DEFAULT_PATH)) printf("Error: Could not save data to '%s'.\n", SNAPSHOT_DEFAULT_PATH);
     freeHeap(g_userHeap);
+    fxFreeTables();
+    freeLotPool();
+    freeAlertPool();
+    freeColdLogDictionary();
     return 0;
 
 }
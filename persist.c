@@ -0,0 +1,512 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+/* Snapshots are written by a forked child: fork gives it a copy-on-write
+   image of the engine as of one instant, so the interactive thread only
+   waits for the fork itself. The child may not malloc or use stdio (another
+   thread may have held their locks at fork time), so the writer below
+   fills a static buffer and flushes it with write(2). */
+
+#define SNAPSHOT_MAGIC "WLTHSNP1"
+#define SNAPSHOT_END "WLTHEND1"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_COLD_LOG_MAX (1LL << 32)
+
+static unsigned char g_writeBuffer[1 << 16];
+static size_t g_writeLength = 0;
+static int g_writeFd = -1;
+static int g_writeFailed = 0;
+
+static void flushWriter(void) {
+    size_t done = 0;
+    while (done < g_writeLength && !g_writeFailed) {
+        ssize_t n = write(g_writeFd, g_writeBuffer + done, g_writeLength - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) g_writeFailed = 1;
+        else done += (size_t)n;
+    }
+    g_writeLength = 0;
+}
+
+static void putBytes(const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    while (length > 0) {
+        if (g_writeLength == sizeof(g_writeBuffer)) flushWriter();
+        size_t room = sizeof(g_writeBuffer) - g_writeLength;
+        size_t chunk = length < room ? length : room;
+        memcpy(g_writeBuffer + g_writeLength, p, chunk);
+        g_writeLength += chunk;
+        p += chunk;
+        length -= chunk;
+    }
+}
+
+static void putInt(int v) { putBytes(&v, sizeof(v)); }
+static void putLong(long long v) { putBytes(&v, sizeof(v)); }
+static void putDouble(double v) { putBytes(&v, sizeof(v)); }
+
+static void putString(const char* s) {
+    int length = (int)strlen(s);
+    putInt(length);
+    putBytes(s, (size_t)length);
+}
+
+static void writeNode(UserProfile* user, const WealthNode* node) {
+    putString(node->name);
+    putDouble(node->value);
+    putDouble(node->interestRate);
+    putInt(node->currencyId);
+    if (node->currencyId > 0) putDouble(fxHoldingNativeValue(node));
+
+    const LotQueue* q = node->lots;
+    putInt(q != NULL);
+    if (q != NULL) {
+        putInt(q->method);
+        putDouble(q->realizedGain);
+        putDouble(q->totalCost);
+        putInt(q->lotCount);
+        LotCursor cursor;
+        const Lot* lot;
+        openLotCursor(&cursor, q);
+        while ((lot = nextLot(&cursor)) != NULL) {
+            putDouble(lot->units);
+            putDouble(lot->unitCost);
+            putLong((long long)lot->date);
+        }
+    }
+
+    int children = 0;
+    for (const WealthNode* c = node->firstChild; c != NULL; c = c->nextSibling) children++;
+    putInt(children);
+    for (const WealthNode* c = node->firstChild; c != NULL; c = c->nextSibling) writeNode(user, c);
+}
+
+static void writeUser(UserProfile* user) {
+    putString(user->name);
+    putDouble(user->netWorth);
+    putLong((long long)user->lastAccess);
+    writeNode(user, user->wealthTreeRoot);
+
+    int entries = 0;
+    for (const ExpenditureNode* e = user->expenseListHead; e != NULL; e = e->next) entries++;
+    putInt(entries);
+    for (const ExpenditureNode* e = user->expenseListHead; e != NULL; e = e->next) {
+        putString(e->category);
+        putString(e->description);
+        putDouble(e->amount);
+        putLong((long long)e->date);
+        putInt(e->investmentType);
+    }
+
+    /* The cold stream is saved as it is stored; its dictionary ids refer to
+       the dictionary written once at the top of the file. */
+    const ColdLog* cold = user->coldLog;
+    putInt(cold != NULL && cold->count > 0);
+    if (cold != NULL && cold->count > 0) {
+        putInt(cold->count);
+        putLong((long long)cold->baseDate);
+        putLong((long long)cold->lastDate);
+        putLong((long long)cold->oldestDate);
+        putLong((long long)(cold->length - cold->start));
+        putBytes(cold->bytes + cold->start, cold->length - cold->start);
+    }
+
+    int rollups = 0;
+    for (const ExpenseRollup* r = user->rollupListHead; r != NULL; r = r->next) rollups++;
+    putInt(rollups);
+    for (const ExpenseRollup* r = user->rollupListHead; r != NULL; r = r->next) {
+        putInt(r->period);
+        putString(r->category);
+        putString(r->ticker);
+        putInt(r->investmentType);
+        putDouble(r->amount);
+        putInt(r->count);
+    }
+
+    int schedules = 0;
+    for (const RecurringSchedule* s = user->scheduleListHead; s != NULL; s = s->userNext) schedules++;
+    putInt(schedules);
+    for (const RecurringSchedule* s = user->scheduleListHead; s != NULL; s = s->userNext) {
+        putInt(s->kind);
+        putInt(s->interval);
+        putString(s->target);
+        putString(s->description);
+        putDouble(s->amount);
+        putLong((long long)s->nextDue);
+        putInt(s->anchorDay);
+    }
+}
+
+/* Writes to `tmpPath`, then renames over `path`, so a crash mid-write
+   leaves the previous snapshot in place. Safe to call in a forked child. */
+static int writeSnapshotFile(const char* path, const char* tmpPath) {
+    g_writeFd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (g_writeFd == -1) return 0;
+    g_writeLength = 0;
+    g_writeFailed = 0;
+
+    putBytes(SNAPSHOT_MAGIC, 8);
+    putInt(SNAPSHOT_VERSION);
+    putLong(g_clockOffset);
+    putInt(g_fxCurrencyCount);
+    for (int i = 1; i < g_fxCurrencyCount; i++) {
+        putBytes(g_fxCurrencies[i].code, 4);
+        putDouble(g_fxCurrencies[i].rate);
+    }
+    int strings = coldLogDictionarySize();
+    putInt(strings);
+    for (int i = 0; i < strings; i++) putString(coldLogDictionaryString(i));
+    int users = g_userHeap ? g_userHeap->size : 0;
+    putInt(users);
+    for (int i = 0; i < users; i++) writeUser(g_userHeap->userArray[i]);
+    putBytes(SNAPSHOT_END, 8);
+    flushWriter();
+
+    int ok = !g_writeFailed && fsync(g_writeFd) == 0;
+    if (close(g_writeFd) != 0) ok = 0;
+    g_writeFd = -1;
+    if (ok && rename(tmpPath, path) != 0) ok = 0;
+    if (!ok) unlink(tmpPath);
+    return ok;
+}
+
+static void tmpPathFor(const char* path, char* out, size_t size) {
+    snprintf(out, size, "%s.tmp", path);
+}
+
+int saveSnapshot(const char* path) {
+    char tmpPath[SNAPSHOT_PATH_MAX + 8];
+    if (path == NULL || strlen(path) >= SNAPSHOT_PATH_MAX) return 0;
+    tmpPathFor(path, tmpPath, sizeof(tmpPath));
+    return writeSnapshotFile(path, tmpPath);
+}
+
+/* ---- Loading ---- */
+
+typedef struct SnapshotReader {
+    FILE* file;
+    int failed;
+    int currencyMap[FX_MAX_CURRENCIES];
+} SnapshotReader;
+
+static void getBytes(SnapshotReader* r, void* out, size_t length) {
+    if (r->failed || fread(out, 1, length, r->file) != length) {
+        r->failed = 1;
+        memset(out, 0, length);
+    }
+}
+
+static int getInt(SnapshotReader* r) { int v; getBytes(r, &v, sizeof(v)); return v; }
+static long long getLong(SnapshotReader* r) { long long v; getBytes(r, &v, sizeof(v)); return v; }
+static double getDouble(SnapshotReader* r) { double v; getBytes(r, &v, sizeof(v)); return v; }
+
+/* Strings longer than the destination are a corrupt file, not truncated. */
+static void getString(SnapshotReader* r, char* out, int size) {
+    int length = getInt(r);
+    if (length < 0 || length >= size) {
+        r->failed = 1;
+        length = 0;
+    }
+    getBytes(r, out, (size_t)length);
+    out[length] = '\0';
+}
+
+static WealthNode* readNode(SnapshotReader* r, UserProfile* user, int depth) {
+    char name[50];
+    getString(r, name, sizeof(name));
+    if (r->failed || depth > 64) {
+        r->failed = 1;
+        return NULL;
+    }
+    WealthNode* node = createWealthNode(name, getDouble(r));
+    if (node == NULL) {
+        r->failed = 1;
+        return NULL;
+    }
+    node->interestRate = getDouble(r);
+    int currency = getInt(r);
+    if (currency > 0) {
+        double native = getDouble(r);
+        if (currency >= FX_MAX_CURRENCIES || r->currencyMap[currency] <= 0 ||
+            !fxRegisterHolding(user, node, r->currencyMap[currency])) {
+            r->failed = 1;
+        } else {
+            fxSetHoldingNativeValue(node, native);
+        }
+    }
+
+    if (getInt(r)) {
+        int method = getInt(r);
+        double realized = getDouble(r);
+        double totalCost = getDouble(r);
+        int lots = getInt(r);
+        if (!restoreLot(node, 0.0, 0.0, 0)) r->failed = 1;
+        for (int i = 0; i < lots && !r->failed; i++) {
+            double units = getDouble(r);
+            double unitCost = getDouble(r);
+            time_t date = (time_t)getLong(r);
+            if (!restoreLot(node, units, unitCost, date)) r->failed = 1;
+        }
+        if (node->lots != NULL) {
+            node->lots->method = method == COST_AVERAGE ? COST_AVERAGE : COST_FIFO;
+            node->lots->realizedGain = realized;
+            node->lots->totalCost = totalCost;
+        }
+    }
+
+    int children = getInt(r);
+    for (int i = 0; i < children && !r->failed; i++) {
+        WealthNode* child = readNode(r, user, depth + 1);
+        if (child == NULL) break;
+        addWealthChild(node, child);
+    }
+    return node;
+}
+
+static UserProfile* readUser(SnapshotReader* r) {
+    char name[50];
+    getString(r, name, sizeof(name));
+    UserProfile* user = r->failed ? NULL : createUserProfile(name);
+    if (user == NULL) {
+        r->failed = 1;
+        return NULL;
+    }
+    user->netWorth = getDouble(r);
+    user->lastAccess = (time_t)getLong(r);
+    user->wealthTreeRoot = readNode(r, user, 0);
+
+    ExpenditureNode** tail = &user->expenseListHead;
+    int entries = getInt(r);
+    for (int i = 0; i < entries && !r->failed; i++) {
+        ExpenditureNode* e = (ExpenditureNode*)malloc(sizeof(ExpenditureNode));
+        if (e == NULL) { r->failed = 1; break; }
+        getString(r, e->category, sizeof(e->category));
+        getString(r, e->description, sizeof(e->description));
+        e->amount = getDouble(r);
+        e->date = (time_t)getLong(r);
+        e->investmentType = (InvestmentType)getInt(r);
+        e->next = NULL;
+        e->prev = user->expenseListTail;
+        *tail = e;
+        tail = &e->next;
+        user->expenseListTail = e;
+    }
+
+    if (getInt(r) && !r->failed) {
+        ColdLog* cold = createColdLog();
+        if (cold == NULL) r->failed = 1;
+        else user->coldLog = cold;
+        int count = getInt(r);
+        time_t baseDate = (time_t)getLong(r);
+        time_t lastDate = (time_t)getLong(r);
+        time_t oldestDate = (time_t)getLong(r);
+        long long length = getLong(r);
+        if (length <= 0 || length > SNAPSHOT_COLD_LOG_MAX) r->failed = 1;
+        if (!r->failed) {
+            cold->bytes = (unsigned char*)malloc((size_t)length);
+            if (cold->bytes == NULL) r->failed = 1;
+        }
+        if (!r->failed) {
+            cold->length = cold->capacity = (size_t)length;
+            cold->count = count;
+            cold->baseDate = baseDate;
+            cold->lastDate = lastDate;
+            cold->oldestDate = oldestDate;
+            getBytes(r, cold->bytes, cold->length);
+            if (!coldLogValid(cold)) r->failed = 1;
+        }
+    }
+
+    ExpenseRollup** rollupTail = &user->rollupListHead;
+    int rollups = getInt(r);
+    for (int i = 0; i < rollups && !r->failed; i++) {
+        ExpenseRollup* rollup = (ExpenseRollup*)malloc(sizeof(ExpenseRollup));
+        if (rollup == NULL) { r->failed = 1; break; }
+        rollup->period = getInt(r);
+        getString(r, rollup->category, sizeof(rollup->category));
+        getString(r, rollup->ticker, sizeof(rollup->ticker));
+        rollup->investmentType = (InvestmentType)getInt(r);
+        rollup->amount = getDouble(r);
+        rollup->count = getInt(r);
+        rollup->next = NULL;
+        *rollupTail = rollup;
+        rollupTail = &rollup->next;
+    }
+
+    /* addRecurringSchedule prepends, so the list is reversed afterwards. */
+    int schedules = getInt(r);
+    for (int i = 0; i < schedules && !r->failed; i++) {
+        char target[50], description[100];
+        ScheduleKind kind = (ScheduleKind)getInt(r);
+        ScheduleInterval interval = (ScheduleInterval)getInt(r);
+        getString(r, target, sizeof(target));
+        getString(r, description, sizeof(description));
+        double amount = getDouble(r);
+        time_t nextDue = (time_t)getLong(r);
+        int anchorDay = getInt(r);
+        if (r->failed) break;
+        RecurringSchedule* s = addRecurringSchedule(user, kind, interval, target, description, amount, nextDue);
+        if (s == NULL) { r->failed = 1; break; }
+        s->anchorDay = anchorDay;
+    }
+    RecurringSchedule* reversed = NULL;
+    while (user->scheduleListHead != NULL) {
+        RecurringSchedule* s = user->scheduleListHead;
+        user->scheduleListHead = s->userNext;
+        s->userNext = reversed;
+        reversed = s;
+    }
+    user->scheduleListHead = reversed;
+
+    /* A user cut short by a bad file is dropped; unregisterUser frees it. */
+    heapInsert(g_userHeap, user);
+    if (r->failed || findUserIndex(g_userHeap, user) == -1) {
+        r->failed = 1;
+        unregisterUser(user);
+        return NULL;
+    }
+    return user;
+}
+
+/* Returns the number of users loaded, 0 if there is no snapshot, or -1 if
+   the file is unreadable. Users read before an error are kept. */
+int loadSnapshot(const char* path) {
+    if (path == NULL || g_userHeap == NULL) return -1;
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return errno == ENOENT ? 0 : -1;
+
+    SnapshotReader reader;
+    SnapshotReader* r = &reader;
+    memset(r, 0, sizeof(reader));
+    r->file = file;
+
+    char magic[8];
+    getBytes(r, magic, sizeof(magic));
+    if (r->failed || memcmp(magic, SNAPSHOT_MAGIC, 8) != 0 || getInt(r) != SNAPSHOT_VERSION) {
+        fclose(file);
+        return -1;
+    }
+    g_clockOffset = (long)getLong(r);
+
+    int currencies = getInt(r);
+    if (currencies < 1 || currencies > FX_MAX_CURRENCIES) r->failed = 1;
+    for (int i = 1; i < currencies && !r->failed; i++) {
+        char code[4];
+        getBytes(r, code, sizeof(code));
+        code[3] = '\0';
+        double rate = getDouble(r);
+        if (!r->failed) r->currencyMap[i] = fxSetRate(code, rate);
+    }
+
+    int strings = getInt(r);
+    if (strings < 0 || strings > COLD_LOG_DICT_MAX) r->failed = 1;
+    for (int i = 0; i < strings && !r->failed; i++) {
+        char string[100];
+        getString(r, string, sizeof(string));
+        if (!r->failed && !restoreColdLogString(string, i)) r->failed = 1;
+    }
+
+    int users = getInt(r);
+    int loaded = 0;
+    for (int i = 0; i < users && !r->failed; i++) {
+        if (readUser(r) != NULL) loaded++;
+    }
+    getBytes(r, magic, sizeof(magic));
+    if (memcmp(magic, SNAPSHOT_END, 8) != 0) r->failed = 1;
+    fclose(file);
+    return r->failed ? -1 : loaded;
+}
+
+/* ---- Background autosave ---- */
+
+static pthread_mutex_t g_engineLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long g_engineGeneration = 0;
+
+static pthread_mutex_t g_autosaveLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_autosaveWake = PTHREAD_COND_INITIALIZER;
+static pthread_t g_autosaveThread;
+static int g_autosaveRunning = 0;
+static int g_autosaveStopping = 0;
+static int g_autosaveInterval = AUTOSAVE_INTERVAL_SECONDS;
+static char g_autosavePath[SNAPSHOT_PATH_MAX];
+static char g_autosaveTmpPath[SNAPSHOT_PATH_MAX + 8];
+static unsigned long g_startGeneration = 0;
+
+/* The interactive thread holds the engine lock except while waiting for
+   input. Every re-acquire counts as possible activity, so an idle session
+   does not rewrite the snapshot. */
+void lockEngine(void) {
+    pthread_mutex_lock(&g_engineLock);
+    g_engineGeneration++;
+}
+
+void unlockEngine(void) {
+    pthread_mutex_unlock(&g_engineLock);
+}
+
+static void* autosaveMain(void* arg) {
+    unsigned long savedGeneration = *(unsigned long*)arg;
+    pthread_mutex_lock(&g_autosaveLock);
+    while (!g_autosaveStopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += g_autosaveInterval;
+        while (!g_autosaveStopping &&
+               pthread_cond_timedwait(&g_autosaveWake, &g_autosaveLock, &deadline) != ETIMEDOUT) {
+        }
+        if (g_autosaveStopping) break;
+        pthread_mutex_unlock(&g_autosaveLock);
+
+        pthread_mutex_lock(&g_engineLock);
+        unsigned long generation = g_engineGeneration;
+        pid_t child = -1;
+        if (generation != savedGeneration) {
+            child = fork();
+            if (child == 0) _exit(writeSnapshotFile(g_autosavePath, g_autosaveTmpPath) ? 0 : 1);
+        }
+        pthread_mutex_unlock(&g_engineLock);
+
+        if (child > 0) {
+            int status = 0;
+            while (waitpid(child, &status, 0) == -1 && errno == EINTR) {
+            }
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) savedGeneration = generation;
+        }
+        pthread_mutex_lock(&g_autosaveLock);
+    }
+    pthread_mutex_unlock(&g_autosaveLock);
+    return NULL;
+}
+
+/* Called with the engine lock held, once the engine matches what is on
+   disk (after loadSnapshot), so the first save waits for a real change. */
+int startAutosave(const char* path, int intervalSeconds) {
+    if (g_autosaveRunning || path == NULL || strlen(path) >= SNAPSHOT_PATH_MAX || intervalSeconds <= 0) return 0;
+    strcpy(g_autosavePath, path);
+    tmpPathFor(path, g_autosaveTmpPath, sizeof(g_autosaveTmpPath));
+    g_autosaveInterval = intervalSeconds;
+    g_autosaveStopping = 0;
+    g_startGeneration = g_engineGeneration;
+    if (pthread_create(&g_autosaveThread, NULL, autosaveMain, &g_startGeneration) != 0) return 0;
+    g_autosaveRunning = 1;
+    return 1;
+}
+
+/* Must be called without the engine lock held: an in-flight save finishes
+   first. The caller then writes the final snapshot itself. */
+void stopAutosave(void) {
+    if (!g_autosaveRunning) return;
+    pthread_mutex_lock(&g_autosaveLock);
+    g_autosaveStopping = 1;
+    pthread_cond_signal(&g_autosaveWake);
+    pthread_mutex_unlock(&g_autosaveLock);
+    pthread_join(g_autosaveThread, NULL);
+    g_autosaveRunning = 0;
+}
@@ -0,0 +1,97 @@
+#include "wealth.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+static const char* g_genericAssets[] = {"gold", "real estate", "others"};
+static const InvestmentType g_genericTypes[] = {INV_GOLD, INV_PROPERTY, INV_OTHERS};
+
+/* Only stock purchases count: rollups keep the ticker for those alone, so
+   matching any other entry by description would change totals on folding. */
+double getCostBasis(UserProfile* user, const char* name) {
+    double total = 0.0;
+    ExpenseCursor cursor;
+    const ExpenditureNode* current;
+    openExpenseCursor(&cursor, user->expenseListHead, user->coldLog);
+    while ((current = nextExpense(&cursor)) != NULL) {
+        if (current->investmentType == INV_STOCKS && strcasecmp(current->description, name) == 0) {
+            total += current->amount;
+        }
+    }
+    ExpenseRollup* rollup = user->rollupListHead;
+    while (rollup != NULL) {
+        if (rollup->investmentType == INV_STOCKS && strcasecmp(rollup->ticker, name) == 0) {
+            total += rollup->amount;
+        }
+        rollup = rollup->next;
+    }
+    return total;
+}
+
+/* One pass over the log and rollups totals every investment type at once. */
+static void sumInvestmentCosts(UserProfile* user, double costs[INV_OTHERS + 1]) {
+    for (int i = 0; i <= INV_OTHERS; i++) costs[i] = 0.0;
+    ExpenseCursor cursor;
+    const ExpenditureNode* current;
+    openExpenseCursor(&cursor, user->expenseListHead, user->coldLog);
+    while ((current = nextExpense(&cursor)) != NULL) {
+        if (current->investmentType <= INV_OTHERS) costs[current->investmentType] += current->amount;
+    }
+    for (ExpenseRollup* rollup = user->rollupListHead; rollup != NULL; rollup = rollup->next) {
+        if (rollup->investmentType <= INV_OTHERS) costs[rollup->investmentType] += rollup->amount;
+    }
+}
+
+static void setRow(PortfolioRow* row, const char* name, const WealthNode* holding, int isStock,
+                   double cost, double realized) {
+    snprintf(row->name, sizeof(row->name), "%s", name);
+    row->holding = holding;
+    row->isStock = isStock;
+    row->cost = cost;
+    row->market = holding->value;
+    row->realized = realized;
+}
+
+/* Rows come out as the portfolio view lists them: stocks, then the general
+   assets, then cash from sales. The caller frees the array. */
+PortfolioRow* buildPortfolio(UserProfile* user, int* countOut, PortfolioRow* total) {
+    *countOut = 0;
+    memset(total, 0, sizeof(*total));
+    strcpy(total->name, "TOTAL");
+    if (user == NULL || user->wealthTreeRoot == NULL) return NULL;
+    WealthNode* invRoot = findWealthNode(user->wealthTreeRoot, "Investments");
+    if (invRoot == NULL) return NULL;
+
+    WealthNode* stockCat = findWealthNode(invRoot, "stock");
+    int capacity = 4;
+    for (WealthNode* child = stockCat ? stockCat->firstChild : NULL; child != NULL; child = child->nextSibling) capacity++;
+    PortfolioRow* rows = (PortfolioRow*)malloc(sizeof(PortfolioRow) * capacity);
+    if (rows == NULL) return NULL;
+    int count = 0;
+
+    for (WealthNode* child = stockCat ? stockCat->firstChild : NULL; child != NULL; child = child->nextSibling) {
+        /* Lot-tracked holdings report the cost of the shares still held;
+           older holdings fall back to the purchase log. */
+        double cost = child->lots ? child->lots->totalCost : getCostBasis(user, child->name);
+        double realized = child->lots ? child->lots->realizedGain : 0.0;
+        setRow(&rows[count++], child->name, child, 1, cost, realized);
+    }
+
+    double costs[INV_OTHERS + 1];
+    sumInvestmentCosts(user, costs);
+    for (int i = 0; i < 3; i++) {
+        WealthNode* node = findWealthNode(invRoot, g_genericAssets[i]);
+        if (node) setRow(&rows[count++], g_genericAssets[i], node, 0, costs[g_genericTypes[i]], 0.0);
+    }
+
+    WealthNode* cash = findWealthNode(invRoot, "cash");
+    if (cash) setRow(&rows[count++], "cash (from sales)", cash, 0, cash->value, 0.0);
+
+    for (int i = 0; i < count; i++) {
+        total->cost += rows[i].cost;
+        total->market += rows[i].market;
+        total->realized += rows[i].realized;
+    }
+    *countOut = count;
+    return rows;
+}
@@ -0,0 +1,242 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Hierarchical timer wheel: level 0 holds the next TIMER_WHEEL_SLOTS ticks,
+   each higher level covers TIMER_WHEEL_SLOTS times the span of the one
+   below. Schedules cascade down a level as their slot comes due, so each
+   tick only touches the schedules that actually fire. */
+static RecurringSchedule* g_timerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static long long g_currentTick = -1;
+static int g_pendingSchedules = 0;
+
+static long long tickOf(time_t when) {
+    return (long long)(when / TIMER_TICK_SECONDS);
+}
+
+static void ensureWheelStarted(void) {
+    if (g_currentTick < 0) g_currentTick = tickOf(engineNow());
+}
+
+static void wheelPlace(RecurringSchedule* s, long long expires) {
+    long long delta = expires - g_currentTick;
+
+    int level = 0;
+    long long span = TIMER_WHEEL_SLOTS;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= span) {
+        span *= TIMER_WHEEL_SLOTS;
+        level++;
+    }
+    /* Past the top level's range: park it in the farthest slot and let the
+       cascade re-file it when that slot comes round. */
+    if (delta >= span) expires = g_currentTick + span - 1;
+
+    int slot = (int)((expires >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    s->wheelLevel = level;
+    s->wheelSlot = slot;
+    s->wheelPrev = NULL;
+    s->wheelNext = g_timerWheel[level][slot];
+    if (s->wheelNext != NULL) s->wheelNext->wheelPrev = s;
+    g_timerWheel[level][slot] = s;
+    g_pendingSchedules++;
+}
+
+/* The current tick's slot has already been run, so anything new that is
+   already due goes into the next one. */
+static void wheelInsert(RecurringSchedule* s) {
+    long long expires = tickOf(s->nextDue);
+    if (expires <= g_currentTick) expires = g_currentTick + 1;
+    wheelPlace(s, expires);
+}
+
+static void wheelUnlink(RecurringSchedule* s) {
+    if (s->wheelPrev != NULL) {
+        s->wheelPrev->wheelNext = s->wheelNext;
+    } else {
+        g_timerWheel[s->wheelLevel][s->wheelSlot] = s->wheelNext;
+    }
+    if (s->wheelNext != NULL) s->wheelNext->wheelPrev = s->wheelPrev;
+    s->wheelPrev = s->wheelNext = NULL;
+    g_pendingSchedules--;
+}
+
+static void cascade(int level, int slot) {
+    RecurringSchedule* s = g_timerWheel[level][slot];
+    g_timerWheel[level][slot] = NULL;
+    while (s != NULL) {
+        RecurringSchedule* next = s->wheelNext;
+        g_pendingSchedules--;
+        /* Cascades run before the current slot fires, so a schedule due on
+           this very tick lands in that slot and is not held back a tick. */
+        long long expires = tickOf(s->nextDue);
+        if (expires < g_currentTick) expires = g_currentTick;
+        wheelPlace(s, expires);
+        s = next;
+    }
+}
+
+static time_t addMonths(time_t when, int months, int anchorDay) {
+    static const int daysIn[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    struct tm t = *localtime(&when);
+    int month = t.tm_mon + months;
+    t.tm_year += month / 12;
+    t.tm_mon = month % 12;
+    int year = t.tm_year + 1900;
+    int maxDay = daysIn[t.tm_mon];
+    if (t.tm_mon == 1 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) maxDay = 29;
+    t.tm_mday = anchorDay < maxDay ? anchorDay : maxDay;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+static time_t nextOccurrence(const RecurringSchedule* s) {
+    switch (s->interval) {
+        case EVERY_WEEK:    return s->nextDue + 7 * 24 * 60 * 60;
+        case EVERY_MONTH:   return addMonths(s->nextDue, 1, s->anchorDay);
+        case EVERY_QUARTER: return addMonths(s->nextDue, 3, s->anchorDay);
+        default:            return s->nextDue + 24 * 60 * 60;
+    }
+}
+
+static void applySchedule(RecurringSchedule* s) {
+    UserProfile* user = s->user;
+    switch (s->kind) {
+        case SCHED_INCOME: {
+            WealthNode* salary = findWealthNode(user->wealthTreeRoot, "salary");
+            if (salary == NULL) return;
+            setWealthNodeValue(user, "salary", salary->value + s->amount);
+            finalizeUserUpdates(user);
+            break;
+        }
+        case SCHED_STOCK_SIP: {
+            /* SIPs buy whole lots at the last marked price, so they need
+               shares on record to price from; otherwise the run is skipped. */
+            WealthNode* held = findStockHolding(user, s->target);
+            if (held == NULL || held->lots == NULL || held->lots->totalUnits <= LOT_UNIT_EPSILON || held->value <= 0) return;
+            double price = fxHoldingNativeValue(held) / held->lots->totalUnits;
+            buyStockLots(user, s->target, s->amount / price, price, -1, NULL);
+            break;
+        }
+        case SCHED_EXPENSE:
+            logExpenseToList(user, s->target, s->description, s->amount, INV_NONE);
+            updateExpenseCategoryTotal(user, s->target, s->amount);
+            finalizeUserUpdates(user);
+            break;
+    }
+}
+
+RecurringSchedule* addRecurringSchedule(UserProfile* user, ScheduleKind kind, ScheduleInterval interval,
+                                        const char* target, const char* description, double amount, time_t firstDue) {
+    if (user == NULL || amount <= 0) return NULL;
+    if (kind != SCHED_INCOME && (target == NULL || target[0] == '\0')) return NULL;
+
+    RecurringSchedule* s = (RecurringSchedule*)malloc(sizeof(RecurringSchedule));
+    if (s == NULL) return NULL;
+    s->user = user;
+    s->kind = kind;
+    s->interval = interval;
+    strncpy(s->target, target ? target : "", 49);
+    s->target[49] = '\0';
+    strncpy(s->description, description ? description : "", 99);
+    s->description[99] = '\0';
+    s->amount = amount;
+    s->nextDue = firstDue;
+    s->anchorDay = localtime(&firstDue)->tm_mday;
+
+    s->userNext = user->scheduleListHead;
+    user->scheduleListHead = s;
+
+    ensureWheelStarted();
+    wheelInsert(s);
+    return s;
+}
+
+void cancelRecurringSchedule(RecurringSchedule* schedule) {
+    if (schedule == NULL) return;
+    RecurringSchedule** link = &schedule->user->scheduleListHead;
+    while (*link != NULL && *link != schedule) link = &(*link)->userNext;
+    if (*link != NULL) *link = schedule->userNext;
+    wheelUnlink(schedule);
+    free(schedule);
+}
+
+void cancelUserSchedules(UserProfile* user) {
+    if (user == NULL) return;
+    RecurringSchedule* s = user->scheduleListHead;
+    while (s != NULL) {
+        RecurringSchedule* next = s->userNext;
+        wheelUnlink(s);
+        free(s);
+        s = next;
+    }
+    user->scheduleListHead = NULL;
+}
+
+/* Fires everything due up to `now`. All schedules sharing a tick form one
+   batch: they go through the normal update paths with the clock pinned to
+   their due time, and each touched user is finalized once at the end. */
+int runDueSchedules(time_t now) {
+    ensureWheelStarted();
+    long long target = tickOf(now);
+    int fired = 0;
+
+    while (g_currentTick < target) {
+        if (g_pendingSchedules == 0) {
+            g_currentTick = target;
+            break;
+        }
+        g_currentTick++;
+
+        int index = (int)(g_currentTick & (TIMER_WHEEL_SLOTS - 1));
+        for (int level = 1; level < TIMER_WHEEL_LEVELS && index == 0; level++) {
+            index = (int)((g_currentTick >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+            cascade(level, index);
+        }
+
+        int slot = (int)(g_currentTick & (TIMER_WHEEL_SLOTS - 1));
+        RecurringSchedule* due = g_timerWheel[0][slot];
+        if (due == NULL) continue;
+        g_timerWheel[0][slot] = NULL;
+
+        beginUpdateBatch();
+        while (due != NULL) {
+            RecurringSchedule* next = due->wheelNext;
+            g_pendingSchedules--;
+            pinEngineClock(due->nextDue);
+            applySchedule(due);
+            due->nextDue = nextOccurrence(due);
+            wheelInsert(due);
+            fired++;
+            due = next;
+        }
+        endUpdateBatch();
+        pinEngineClock(0);
+    }
+    return fired;
+}
+
+int advanceEngineClock(long seconds) {
+    if (seconds <= 0) return 0;
+    int fired = runDueSchedules(engineNow());
+    g_clockOffset += seconds;
+    return fired + runDueSchedules(engineNow());
+}
+
+void printUserSchedules(UserProfile* user) {
+    static const char* kinds[] = {"Income", "Stock SIP", "Expense"};
+    static const char* intervals[] = {"weekly", "monthly", "quarterly"};
+    if (user == NULL || user->scheduleListHead == NULL) {
+        printf("No recurring schedules.\n");
+        return;
+    }
+    printf("\n--- Recurring Schedules ---\n");
+    int i = 1;
+    for (RecurringSchedule* s = user->scheduleListHead; s != NULL; s = s->userNext, i++) {
+        char* timeStr = ctime(&s->nextDue);
+        timeStr[strcspn(timeStr, "\n")] = 0;
+        printf("  %d. %s %s%s%s - Rs.%.2f %s (next: %s)\n", i, kinds[s->kind],
+               s->target, s->description[0] ? " / " : "", s->description,
+               s->amount, intervals[s->interval], timeStr);
+    }
+}
@@ -0,0 +1,473 @@
+#include "wealth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/* Each shard is a forked copy of the engine owning one hash partition of the
+   users, with its own g_userHeap. The coordinator talks to it over a Unix
+   socketpair using fixed-size requests; top-K replies are a header followed
+   by entries already in rank order, so the coordinator only merges heads.
+   Only the calls below are forwarded: stocks, FX, schedules and alerts stay
+   in the single-process engine. */
+
+typedef enum ShardOp {
+    SHARD_OP_REGISTER,
+    SHARD_OP_INCOME,
+    SHARD_OP_EXPENSE,
+    SHARD_OP_REMOVE,
+    SHARD_OP_TOP_K,
+    SHARD_OP_COUNT,
+    SHARD_OP_SHUTDOWN
+} ShardOp;
+
+typedef struct ShardRequest {
+    int op;
+    int k;
+    double amount;
+    char name[50];
+    char category[50];
+    char description[100];
+} ShardRequest;
+
+typedef struct ShardReply {
+    int status;
+    int count;
+    double value;
+} ShardReply;
+
+static int writeFull(int fd, const void* buffer, size_t length) {
+    const char* p = (const char*)buffer;
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        length -= (size_t)n;
+    }
+    return 1;
+}
+
+static int readFull(int fd, void* buffer, size_t length) {
+    char* p = (char*)buffer;
+    while (length > 0) {
+        ssize_t n = read(fd, p, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        length -= (size_t)n;
+    }
+    return 1;
+}
+
+/* Names are unique case-insensitively, so they hash case-insensitively. */
+static unsigned int hashName(const char* name) {
+    unsigned int h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h ^= (unsigned int)tolower(*p);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int shardForName(const ShardCluster* cluster, const char* name) {
+    if (cluster == NULL || cluster->count <= 0 || name == NULL) return -1;
+    return (int)(hashName(name) % (unsigned int)cluster->count);
+}
+
+/* ---- Shard side ---- */
+
+/* Open-addressed name index so a shard with a large partition does not scan
+   userArray on every request. Deleted slots keep a tombstone. */
+static UserProfile** g_nameIndex = NULL;
+static int g_nameIndexCapacity = 0;
+static int g_nameIndexUsed = 0;
+static UserProfile g_tombstone;
+
+static int nameSlot(const char* name, int forInsert) {
+    int mask = g_nameIndexCapacity - 1;
+    int i = (int)(hashName(name) & (unsigned int)mask);
+    int firstFree = -1;
+    while (g_nameIndex[i] != NULL) {
+        if (g_nameIndex[i] == &g_tombstone) {
+            if (firstFree == -1) firstFree = i;
+        } else if (strcasecmp(g_nameIndex[i]->name, name) == 0) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    if (!forInsert) return -1;
+    return firstFree != -1 ? firstFree : i;
+}
+
+static int growNameIndex(void) {
+    int oldCapacity = g_nameIndexCapacity;
+    UserProfile** old = g_nameIndex;
+    int newCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+    g_nameIndex = (UserProfile**)calloc((size_t)newCapacity, sizeof(UserProfile*));
+    if (g_nameIndex == NULL) {
+        g_nameIndex = old;
+        return 0;
+    }
+    g_nameIndexCapacity = newCapacity;
+    g_nameIndexUsed = 0;
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i] != NULL && old[i] != &g_tombstone) {
+            g_nameIndex[nameSlot(old[i]->name, 1)] = old[i];
+            g_nameIndexUsed++;
+        }
+    }
+    free(old);
+    return 1;
+}
+
+static UserProfile* lookupUser(const char* name) {
+    if (g_nameIndexCapacity == 0) return NULL;
+    int slot = nameSlot(name, 0);
+    return slot == -1 ? NULL : g_nameIndex[slot];
+}
+
+static int shardRegister(const char* name) {
+    if (strlen(name) == 0 || lookupUser(name) != NULL) return 0;
+    if ((g_nameIndexUsed + 1) * 2 > g_nameIndexCapacity && !growNameIndex()) return 0;
+
+    int before = g_userHeap->size;
+    registerNewUser(name);
+    if (g_userHeap->size == before) return 0;
+
+    UserProfile* user = g_userHeap->userArray[g_userHeap->size - 1];
+    int slot = nameSlot(name, 1);
+    if (g_nameIndex[slot] == NULL) g_nameIndexUsed++;
+    g_nameIndex[slot] = user;
+    return 1;
+}
+
+static int shardRemove(const char* name) {
+    if (g_nameIndexCapacity == 0) return 0;
+    int slot = nameSlot(name, 0);
+    if (slot == -1) return 0;
+    UserProfile* user = g_nameIndex[slot];
+    g_nameIndex[slot] = &g_tombstone;
+    unregisterUser(user);
+    return 1;
+}
+
+static int shardApply(const ShardRequest* req, ShardReply* reply) {
+    UserProfile* user = NULL;
+    reply->status = 0;
+    reply->count = 0;
+    reply->value = 0.0;
+
+    switch (req->op) {
+        case SHARD_OP_REGISTER:
+            reply->status = shardRegister(req->name);
+            return 1;
+        case SHARD_OP_REMOVE:
+            reply->status = shardRemove(req->name);
+            return 1;
+        case SHARD_OP_COUNT:
+            reply->status = 1;
+            reply->count = g_userHeap->size;
+            return 1;
+        case SHARD_OP_INCOME:
+        case SHARD_OP_EXPENSE: {
+            user = lookupUser(req->name);
+            if (user == NULL || req->amount <= 0) return 1;
+            if (req->op == SHARD_OP_INCOME) {
+                WealthNode* salary = findWealthNode(user->wealthTreeRoot, "salary");
+                if (salary == NULL) return 1;
+                salary->value += req->amount;
+            } else {
+                WealthNode* expenses = findWealthNode(user->wealthTreeRoot, "Expenses");
+                if (expenses == NULL || findWealthNode(expenses->firstChild, req->category) == NULL) return 1;
+                logExpenseToList(user, req->category, req->description, req->amount, INV_NONE);
+                updateExpenseCategoryTotal(user, req->category, req->amount);
+            }
+            finalizeUserUpdates(user);
+            reply->status = 1;
+            reply->value = user->netWorth;
+            return 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+static void sendTopK(int fd, int k) {
+    ShardReply reply = {1, 0, 0.0};
+    if (k > g_userHeap->size) k = g_userHeap->size;
+    UserProfile** top = NULL;
+    ShardEntry* entries = NULL;
+    if (k > 0) {
+        top = (UserProfile**)malloc(sizeof(UserProfile*) * k);
+        entries = (ShardEntry*)malloc(sizeof(ShardEntry) * k);
+        if (top == NULL || entries == NULL) {
+            reply.status = 0;
+            k = 0;
+        }
+    }
+    reply.count = k > 0 ? heapTopK(g_userHeap, k, top) : 0;
+    for (int i = 0; i < reply.count; i++) {
+        memcpy(entries[i].name, top[i]->name, sizeof(entries[i].name));
+        entries[i].netWorth = top[i]->netWorth;
+        entries[i].shard = -1;
+    }
+    if (writeFull(fd, &reply, sizeof(reply)) && reply.count > 0) {
+        writeFull(fd, entries, sizeof(ShardEntry) * reply.count);
+    }
+    free(top);
+    free(entries);
+}
+
+static void serveShard(int fd) {
+    ShardRequest req;
+    ShardReply reply;
+    while (readFull(fd, &req, sizeof(req))) {
+        if (req.op == SHARD_OP_SHUTDOWN) break;
+        if (req.op == SHARD_OP_TOP_K) {
+            sendTopK(fd, req.k);
+            continue;
+        }
+        shardApply(&req, &reply);
+        if (!writeFull(fd, &reply, sizeof(reply))) break;
+    }
+}
+
+static void runShard(int fd) {
+    /* The inherited heap belongs to the coordinator; this shard starts empty. */
+    g_userHeap = createHeap(1024);
+    if (g_userHeap != NULL) serveShard(fd);
+    close(fd);
+    if (g_userHeap != NULL) freeHeap(g_userHeap);
+    free(g_nameIndex);
+    fxFreeTables();
+    freeLotPool();
+    freeAlertPool();
+    freeColdLogDictionary();
+    _exit(0);
+}
+
+/* ---- Coordinator side ---- */
+
+ShardCluster* startShards(int count) {
+    if (count <= 0) return NULL;
+    ShardCluster* cluster = (ShardCluster*)malloc(sizeof(ShardCluster));
+    if (cluster == NULL) return NULL;
+    cluster->pids = (pid_t*)malloc(sizeof(pid_t) * count);
+    cluster->fds = (int*)malloc(sizeof(int) * count);
+    cluster->count = 0;
+    if (cluster->pids == NULL || cluster->fds == NULL) {
+        stopShards(cluster);
+        return NULL;
+    }
+
+    /* Writes to a shard that died should fail, not kill the coordinator. */
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    for (int i = 0; i < count; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1) {
+            printf("Error: Could not create socket for shard %d.\n", i);
+            stopShards(cluster);
+            return NULL;
+        }
+        pid_t pid = fork();
+        if (pid == -1) {
+            printf("Error: Could not start shard %d.\n", i);
+            close(pair[0]);
+            close(pair[1]);
+            stopShards(cluster);
+            return NULL;
+        }
+        if (pid == 0) {
+            for (int j = 0; j < cluster->count; j++) close(cluster->fds[j]);
+            close(pair[0]);
+            runShard(pair[1]);
+        }
+        close(pair[1]);
+        cluster->pids[i] = pid;
+        cluster->fds[i] = pair[0];
+        cluster->count++;
+    }
+    return cluster;
+}
+
+void stopShards(ShardCluster* cluster) {
+    if (cluster == NULL) return;
+    ShardRequest req;
+    memset(&req, 0, sizeof(req));
+    req.op = SHARD_OP_SHUTDOWN;
+    for (int i = 0; i < cluster->count; i++) {
+        writeFull(cluster->fds[i], &req, sizeof(req));
+        close(cluster->fds[i]);
+    }
+    for (int i = 0; i < cluster->count; i++) waitpid(cluster->pids[i], NULL, 0);
+    free(cluster->pids);
+    free(cluster->fds);
+    free(cluster);
+}
+
+static int shardCall(ShardCluster* cluster, int shard, const ShardRequest* req, ShardReply* reply) {
+    if (!writeFull(cluster->fds[shard], req, sizeof(*req)) ||
+        !readFull(cluster->fds[shard], reply, sizeof(*reply))) {
+        printf("Error: Shard %d is not responding.\n", shard);
+        return 0;
+    }
+    return 1;
+}
+
+static int callForUser(ShardCluster* cluster, ShardOp op, const char* name, const char* category,
+                       const char* description, double amount, ShardReply* reply) {
+    int shard = shardForName(cluster, name);
+    if (shard == -1) return 0;
+    ShardRequest req;
+    memset(&req, 0, sizeof(req));
+    req.op = op;
+    req.amount = amount;
+    strncpy(req.name, name, sizeof(req.name) - 1);
+    if (category) strncpy(req.category, category, sizeof(req.category) - 1);
+    if (description) strncpy(req.description, description, sizeof(req.description) - 1);
+    return shardCall(cluster, shard, &req, reply) && reply->status;
+}
+
+int shardRegisterUser(ShardCluster* cluster, const char* name) {
+    ShardReply reply;
+    return callForUser(cluster, SHARD_OP_REGISTER, name, NULL, NULL, 0.0, &reply);
+}
+
+int shardRemoveUser(ShardCluster* cluster, const char* name) {
+    ShardReply reply;
+    return callForUser(cluster, SHARD_OP_REMOVE, name, NULL, NULL, 0.0, &reply);
+}
+
+int shardAddIncome(ShardCluster* cluster, const char* name, double amount, double* netWorth) {
+    ShardReply reply;
+    if (!callForUser(cluster, SHARD_OP_INCOME, name, NULL, NULL, amount, &reply)) return 0;
+    if (netWorth) *netWorth = reply.value;
+    return 1;
+}
+
+int shardAddExpense(ShardCluster* cluster, const char* name, const char* category, const char* description,
+                    double amount, double* netWorth) {
+    ShardReply reply;
+    if (!callForUser(cluster, SHARD_OP_EXPENSE, name, category, description, amount, &reply)) return 0;
+    if (netWorth) *netWorth = reply.value;
+    return 1;
+}
+
+long shardUserCount(ShardCluster* cluster) {
+    if (cluster == NULL) return 0;
+    ShardRequest req;
+    ShardReply reply;
+    memset(&req, 0, sizeof(req));
+    req.op = SHARD_OP_COUNT;
+    long total = 0;
+    for (int i = 0; i < cluster->count; i++) {
+        if (shardCall(cluster, i, &req, &reply)) total += reply.count;
+    }
+    return total;
+}
+
+/* Same order as the engine's heap: net worth descending, then name. */
+static int shardEntryBefore(const ShardEntry* a, const ShardEntry* b) {
+    if (a->netWorth != b->netWorth) return a->netWorth > b->netWorth;
+    return strcmp(a->name, b->name) < 0;
+}
+
+/* The request goes to every shard before any reply is read, so the shards
+   rank their partitions in parallel. The merge then keeps one head per shard
+   in a small heap: O(k log N) on top of the shards' own O(k log k). */
+int shardTopK(ShardCluster* cluster, int k, ShardEntry* out) {
+    if (cluster == NULL || out == NULL || k <= 0 || cluster->count <= 0) return 0;
+    int n = cluster->count;
+
+    ShardRequest req;
+    memset(&req, 0, sizeof(req));
+    req.op = SHARD_OP_TOP_K;
+    req.k = k;
+    for (int i = 0; i < n; i++) writeFull(cluster->fds[i], &req, sizeof(req));
+
+    ShardEntry** lists = (ShardEntry**)calloc((size_t)n, sizeof(ShardEntry*));
+    int* lengths = (int*)calloc((size_t)n, sizeof(int));
+    int* cursor = (int*)calloc((size_t)n, sizeof(int));
+    int* heads = (int*)malloc(sizeof(int) * n);
+    int ok = lists != NULL && lengths != NULL && cursor != NULL && heads != NULL;
+
+    /* Every reply is drained even after a failure so the sockets stay in step. */
+    for (int i = 0; i < n; i++) {
+        ShardReply reply;
+        if (!readFull(cluster->fds[i], &reply, sizeof(reply))) {
+            printf("Error: Shard %d is not responding.\n", i);
+            ok = 0;
+            continue;
+        }
+        ShardEntry* list = reply.count > 0 ? (ShardEntry*)malloc(sizeof(ShardEntry) * reply.count) : NULL;
+        if (reply.count > 0 && list == NULL) {
+            ShardEntry discard;
+            for (int j = 0; j < reply.count; j++) readFull(cluster->fds[i], &discard, sizeof(discard));
+            ok = 0;
+            continue;
+        }
+        if (reply.count > 0 && !readFull(cluster->fds[i], list, sizeof(ShardEntry) * reply.count)) ok = 0;
+        if (lists != NULL && lengths != NULL) {
+            lists[i] = list;
+            lengths[i] = reply.count;
+        } else {
+            free(list);
+        }
+    }
+
+    int count = 0;
+    if (ok) {
+        int headCount = 0;
+        for (int i = 0; i < n; i++) {
+            if (lengths[i] == 0) continue;
+            int c = headCount++;
+            heads[c] = i;
+            while (c > 0) {
+                int parent = (c - 1) / 2;
+                if (!shardEntryBefore(&lists[heads[c]][0], &lists[heads[parent]][0])) break;
+                int temp = heads[c]; heads[c] = heads[parent]; heads[parent] = temp;
+                c = parent;
+            }
+        }
+        while (count < k && headCount > 0) {
+            int s = heads[0];
+            out[count] = lists[s][cursor[s]++];
+            out[count].shard = s;
+            count++;
+            if (cursor[s] == lengths[s]) heads[0] = heads[--headCount];
+            for (int c = 0;;) {
+                int best = c;
+                int left = 2 * c + 1, right = 2 * c + 2;
+                if (left < headCount && shardEntryBefore(&lists[heads[left]][cursor[heads[left]]],
+                                                         &lists[heads[best]][cursor[heads[best]]])) best = left;
+                if (right < headCount && shardEntryBefore(&lists[heads[right]][cursor[heads[right]]],
+                                                          &lists[heads[best]][cursor[heads[best]]])) best = right;
+                if (best == c) break;
+                int temp = heads[c]; heads[c] = heads[best]; heads[best] = temp;
+                c = best;
+            }
+        }
+    }
+
+    if (lists != NULL) {
+        for (int i = 0; i < n; i++) free(lists[i]);
+    }
+    free(lists);
+    free(lengths);
+    free(cursor);
+    free(heads);
+    return count;
+}
+
+int shardTopUser(ShardCluster* cluster, ShardEntry* out) {
+    return shardTopK(cluster, 1, out);
+}
@@ -0,0 +1,144 @@
+#include "wealth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Starts every shard on this machine, drives the same workload through the
+   shards and through a single in-process engine, and checks that the merged
+   leaderboard matches the single heap exactly. */
+
+static unsigned long long g_rng = 88172645463325252ULL;
+
+static unsigned long long nextRandom(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static double elapsedMs(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static UserProfile* localUser(int id) {
+    return id < g_userHeap->size ? g_userHeap->userArray[id] : NULL;
+}
+
+int main(int argc, char** argv) {
+    int shards = argc > 1 ? atoi(argv[1]) : 4;
+    int users = argc > 2 ? atoi(argv[2]) : 20000;
+    int ops = argc > 3 ? atoi(argv[3]) : 100000;
+    int k = argc > 4 ? atoi(argv[4]) : 100;
+    if (shards <= 0 || users <= 0 || ops < 0 || k <= 0) {
+        printf("Usage: %s [shards] [users] [operations] [k]\n", argv[0]);
+        return 1;
+    }
+
+    /* Shards are forked before the reference heap exists so they start empty. */
+    ShardCluster* cluster = startShards(shards);
+    if (cluster == NULL) return 1;
+    g_userHeap = createHeap(users);
+    if (g_userHeap == NULL) { stopShards(cluster); return 1; }
+
+    const char* categories[] = {"health", "travel", "education", "regular"};
+    char name[50];
+    struct timespec start, end;
+    int failures = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < users; i++) {
+        snprintf(name, sizeof(name), "user%07d", i);
+        if (!shardRegisterUser(cluster, name)) failures++;
+        registerNewUser(name);
+    }
+    for (int i = 0; i < ops; i++) {
+        int id = (int)(nextRandom() % (unsigned long long)g_userHeap->size);
+        UserProfile* user = localUser(id);
+        double amount = (double)(nextRandom() % 1000000) / 100.0 + 1.0;
+        double remoteWorth = 0.0;
+        if (nextRandom() % 3 != 0) {
+            if (!shardAddIncome(cluster, user->name, amount, &remoteWorth)) failures++;
+            WealthNode* salary = findWealthNode(user->wealthTreeRoot, "salary");
+            salary->value += amount;
+        } else {
+            const char* category = categories[nextRandom() % 4];
+            if (!shardAddExpense(cluster, user->name, category, "harness", amount, &remoteWorth)) failures++;
+            logExpenseToList(user, category, "harness", amount, INV_NONE);
+            updateExpenseCategoryTotal(user, category, amount);
+        }
+        finalizeUserUpdates(user);
+        if (remoteWorth != user->netWorth) failures++;
+    }
+    for (int i = 0; i < users / 10 && g_userHeap->size > 1; i++) {
+        UserProfile* user = localUser((int)(nextRandom() % (unsigned long long)g_userHeap->size));
+        if (!shardRemoveUser(cluster, user->name)) failures++;
+        unregisterUser(user);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Loaded %d users and %d operations across %d shards in %.1f ms (%d request failures).\n",
+           users, ops, shards, elapsedMs(start, end), failures);
+
+    long total = shardUserCount(cluster);
+    printf("Shards hold %ld users; reference heap holds %d.\n", total, g_userHeap->size);
+    if (total != g_userHeap->size) failures++;
+
+    ShardEntry* merged = (ShardEntry*)malloc(sizeof(ShardEntry) * k);
+    UserProfile** expected = (UserProfile**)malloc(sizeof(UserProfile*) * k);
+    if (merged == NULL || expected == NULL) {
+        free(merged);
+        free(expected);
+        freeHeap(g_userHeap);
+        stopShards(cluster);
+        return 1;
+    }
+
+    int rounds = 200;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int got = 0;
+    for (int r = 0; r < rounds; r++) got = shardTopK(cluster, k, merged);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double shardMs = elapsedMs(start, end) / rounds;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int want = 0;
+    for (int r = 0; r < rounds; r++) want = heapTopK(g_userHeap, k, expected);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double localMs = elapsedMs(start, end) / rounds;
+
+    int mismatches = got == want ? 0 : 1;
+    for (int i = 0; i < got && i < want; i++) {
+        if (strcmp(merged[i].name, expected[i]->name) != 0 || merged[i].netWorth != expected[i]->netWorth) {
+            mismatches++;
+        }
+    }
+    printf("Top-%d: merged %.3f ms per query, single heap %.3f ms per query, %d mismatches.\n",
+           k, shardMs, localMs, mismatches);
+
+    ShardEntry top;
+    if (shardTopUser(cluster, &top)) {
+        printf("Top user: %s (Rs.%.2f) on shard %d.\n", top.name, top.netWorth, top.shard);
+        UserProfile* localTop = getTopWealthUser(g_userHeap);
+        if (localTop == NULL || strcmp(localTop->name, top.name) != 0) mismatches++;
+    }
+    int shown = got < 5 ? got : 5;
+    for (int i = 0; i < shown; i++) {
+        printf("  %d. %-12s Rs.%14.2f  shard %d\n", i + 1, merged[i].name, merged[i].netWorth, merged[i].shard);
+    }
+
+    free(merged);
+    free(expected);
+    stopShards(cluster);
+    freeHeap(g_userHeap);
+    fxFreeTables();
+    freeLotPool();
+    freeAlertPool();
+    freeColdLogDictionary();
+
+    if (failures || mismatches) {
+        printf("FAILED: %d request failures, %d leaderboard mismatches.\n", failures, mismatches);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,455 @@
+#include "wealth.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+/* Each block stores its first point verbatim in the header and every later
+   point as a bit-packed delta against the point before it:
+     time   - delta-of-delta, zigzag, 6-bit length prefix
+     value  - '0' unchanged, '10' + length-prefixed zigzag delta in paise,
+              '11' + the raw 64-bit double when it is not a whole paisa.
+   Net worth is predicted as income - expenses + investments, so it costs a
+   single bit whenever the tree adds up the usual way. */
+
+#define SERIES_MAX_POINT_BITS 344
+#define SERIES_INITIAL_BLOCK_BYTES 64
+
+static const int g_encodeOrder[SERIES_FIELD_COUNT] = {
+    SERIES_INCOME, SERIES_EXPENSES, SERIES_INVESTMENTS, SERIES_NET_WORTH
+};
+
+typedef struct BitCursor {
+    const unsigned char* bytes;
+    int pos;
+} BitCursor;
+
+static void writeBits(SeriesBlock* block, unsigned long long value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        if ((value >> i) & 1ULL) block->bits[block->bitLength >> 3] |= (unsigned char)(0x80 >> (block->bitLength & 7));
+        block->bitLength++;
+    }
+}
+
+static unsigned long long readBits(BitCursor* c, int count) {
+    unsigned long long value = 0;
+    for (int i = 0; i < count; i++) {
+        value = (value << 1) | ((c->bytes[c->pos >> 3] >> (7 - (c->pos & 7))) & 1);
+        c->pos++;
+    }
+    return value;
+}
+
+static unsigned long long zigzag(long long v) {
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static long long unzigzag(unsigned long long v) {
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static int bitWidth(unsigned long long v) {
+    int n = 0;
+    while (v != 0) { n++; v >>= 1; }
+    return n;
+}
+
+/* Length prefix is 6 bits, so a 64-bit payload is written as width 63 plus
+   an explicit top bit; in practice widths stay far below that. */
+static void writeVarBits(SeriesBlock* block, unsigned long long v) {
+    int n = bitWidth(v);
+    if (n > 63) n = 63;
+    writeBits(block, (unsigned long long)n, 6);
+    if (n == 63) writeBits(block, v >> 63, 1);
+    if (n > 0) writeBits(block, v, n);
+}
+
+static unsigned long long readVarBits(BitCursor* c) {
+    int n = (int)readBits(c, 6);
+    unsigned long long top = 0;
+    if (n == 63) top = readBits(c, 1) << 63;
+    return n > 0 ? top | readBits(c, n) : 0;
+}
+
+static int toPaise(double v, long long* out) {
+    double scaled = round(v * 100.0);
+    if (fabs(scaled) >= 9007199254740992.0 || scaled / 100.0 != v) return 0;
+    *out = (long long)scaled;
+    return 1;
+}
+
+static double predictValue(SeriesField field, const double* prev, const double* current) {
+    if (field != SERIES_NET_WORTH) return prev[field];
+    double sum = 0.0;
+    sum += current[SERIES_INCOME];
+    sum += -current[SERIES_EXPENSES];
+    sum += current[SERIES_INVESTMENTS];
+    return sum;
+}
+
+static void encodeValue(SeriesBlock* block, double predicted, double value) {
+    unsigned long long predictedBits, valueBits;
+    memcpy(&predictedBits, &predicted, sizeof(double));
+    memcpy(&valueBits, &value, sizeof(double));
+    if (predictedBits == valueBits) {
+        writeBits(block, 0, 1);
+        return;
+    }
+    long long p, v;
+    if (toPaise(predicted, &p) && toPaise(value, &v)) {
+        writeBits(block, 2, 2);
+        writeVarBits(block, zigzag(v - p));
+        return;
+    }
+    writeBits(block, 3, 2);
+    writeBits(block, valueBits, 64);
+}
+
+static double decodeValue(BitCursor* c, double predicted) {
+    if (readBits(c, 1) == 0) return predicted;
+    if (readBits(c, 1) == 0) {
+        long long p = 0;
+        toPaise(predicted, &p);
+        return (double)(p + unzigzag(readVarBits(c))) / 100.0;
+    }
+    unsigned long long bits = readBits(c, 64);
+    double value;
+    memcpy(&value, &bits, sizeof(double));
+    return value;
+}
+
+/* The open block starts small and doubles up to SERIES_BLOCK_BYTES, so a
+   user with a handful of points does not pay for a whole block. A full
+   block is trimmed to the bytes it actually used. */
+static SeriesBlock* growBlock(NetWorthSeries* series, SeriesBlock* block) {
+    int newCapacity = block->byteCapacity * 2;
+    if (newCapacity > SERIES_BLOCK_BYTES) newCapacity = SERIES_BLOCK_BYTES;
+    SeriesBlock* grown = (SeriesBlock*)realloc(block, sizeof(SeriesBlock) + newCapacity);
+    if (grown == NULL) return NULL;
+    memset(grown->bits + grown->byteCapacity, 0, newCapacity - grown->byteCapacity);
+    grown->byteCapacity = newCapacity;
+    series->blocks[series->blockCount - 1] = grown;
+    return grown;
+}
+
+static void sealBlock(NetWorthSeries* series) {
+    if (series->blockCount == 0) return;
+    SeriesBlock* block = series->blocks[series->blockCount - 1];
+    int used = (block->bitLength + 7) / 8;
+    SeriesBlock* trimmed = (SeriesBlock*)realloc(block, sizeof(SeriesBlock) + used);
+    if (trimmed == NULL) return;
+    trimmed->byteCapacity = used;
+    series->blocks[series->blockCount - 1] = trimmed;
+}
+
+static SeriesBlock* openBlock(NetWorthSeries* series, time_t when, const double* values) {
+    sealBlock(series);
+    if (series->blockCount >= series->blockCapacity) {
+        int newCap = series->blockCapacity ? series->blockCapacity * 2 : 4;
+        SeriesBlock** grown = (SeriesBlock**)realloc(series->blocks, sizeof(SeriesBlock*) * newCap);
+        if (grown == NULL) return NULL;
+        series->blocks = grown;
+        series->blockCapacity = newCap;
+    }
+    SeriesBlock* block = (SeriesBlock*)calloc(1, sizeof(SeriesBlock) + SERIES_INITIAL_BLOCK_BYTES);
+    if (block == NULL) return NULL;
+    block->byteCapacity = SERIES_INITIAL_BLOCK_BYTES;
+    block->firstTime = block->lastTime = when;
+    block->count = 1;
+    for (int f = 0; f < SERIES_FIELD_COUNT; f++) {
+        block->first[f] = block->min[f] = block->max[f] = block->last[f] = values[f];
+    }
+    series->blocks[series->blockCount++] = block;
+    series->prevDelta = 0;
+    return block;
+}
+
+static void appendPoint(NetWorthSeries* series, time_t when, const double* values) {
+    SeriesBlock* block = series->blockCount > 0 ? series->blocks[series->blockCount - 1] : NULL;
+    if (block != NULL && when < block->lastTime) when = block->lastTime;
+
+    if (block != NULL && block->bitLength + SERIES_MAX_POINT_BITS > block->byteCapacity * 8 &&
+        block->byteCapacity < SERIES_BLOCK_BYTES) {
+        SeriesBlock* grown = growBlock(series, block);
+        if (grown == NULL) return;
+        block = grown;
+    }
+
+    if (block == NULL || block->bitLength + SERIES_MAX_POINT_BITS > block->byteCapacity * 8) {
+        if (openBlock(series, when, values) == NULL) return;
+    } else {
+        long long delta = (long long)(when - block->lastTime);
+        writeVarBits(block, zigzag(delta - series->prevDelta));
+        series->prevDelta = delta;
+        for (int i = 0; i < SERIES_FIELD_COUNT; i++) {
+            int f = g_encodeOrder[i];
+            encodeValue(block, predictValue((SeriesField)f, block->last, values), values[f]);
+        }
+        block->lastTime = when;
+        block->count++;
+        for (int f = 0; f < SERIES_FIELD_COUNT; f++) {
+            if (values[f] < block->min[f]) block->min[f] = values[f];
+            if (values[f] > block->max[f]) block->max[f] = values[f];
+            block->last[f] = values[f];
+        }
+    }
+    series->pointCount++;
+}
+
+static double branchValue(WealthNode* root, const char* name) {
+    for (WealthNode* child = root->firstChild; child != NULL; child = child->nextSibling) {
+        if (strcmp(child->name, name) == 0) return child->value;
+    }
+    return 0.0;
+}
+
+void recordNetWorthSample(UserProfile* user) {
+    if (user == NULL || user->wealthTreeRoot == NULL) return;
+
+    double values[SERIES_FIELD_COUNT];
+    values[SERIES_NET_WORTH] = user->netWorth;
+    values[SERIES_INCOME] = branchValue(user->wealthTreeRoot, "Income");
+    values[SERIES_EXPENSES] = branchValue(user->wealthTreeRoot, "Expenses");
+    values[SERIES_INVESTMENTS] = branchValue(user->wealthTreeRoot, "Investments");
+
+    NetWorthSeries* series = user->history;
+    if (series == NULL) {
+        series = (NetWorthSeries*)calloc(1, sizeof(NetWorthSeries));
+        if (series == NULL) return;
+        user->history = series;
+    } else if (series->blockCount > 0) {
+        const double* last = series->blocks[series->blockCount - 1]->last;
+        if (memcmp(last, values, sizeof(values)) == 0) return;
+    }
+    appendPoint(series, engineNow(), values);
+}
+
+typedef void (*SeriesVisitor)(time_t when, const double* values, void* ctx);
+
+static void decodeBlock(const SeriesBlock* block, SeriesVisitor visit, void* ctx) {
+    double values[SERIES_FIELD_COUNT];
+    double current[SERIES_FIELD_COUNT];
+    memcpy(values, block->first, sizeof(values));
+    time_t when = block->firstTime;
+    long long prevDelta = 0;
+    visit(when, values, ctx);
+
+    BitCursor c = { block->bits, 0 };
+    for (int i = 1; i < block->count; i++) {
+        long long delta = prevDelta + unzigzag(readVarBits(&c));
+        when += (time_t)delta;
+        prevDelta = delta;
+        for (int k = 0; k < SERIES_FIELD_COUNT; k++) {
+            int f = g_encodeOrder[k];
+            current[f] = decodeValue(&c, predictValue((SeriesField)f, values, current));
+        }
+        memcpy(values, current, sizeof(values));
+        visit(when, values, ctx);
+    }
+}
+
+static int firstBlockEndingAfter(const NetWorthSeries* series, time_t from) {
+    int lo = 0, hi = series->blockCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (series->blocks[mid]->lastTime < from) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+typedef struct RangeContext {
+    SeriesField field;
+    time_t from, to;
+    SeriesPoint* out;
+    int max, count;
+} RangeContext;
+
+static void collectRange(time_t when, const double* values, void* ctx) {
+    RangeContext* r = (RangeContext*)ctx;
+    if (when < r->from || when > r->to || r->count >= r->max) return;
+    r->out[r->count].time = when;
+    r->out[r->count].value = values[r->field];
+    r->count++;
+}
+
+int querySeriesRange(UserProfile* user, SeriesField field, time_t from, time_t to, SeriesPoint* out, int maxPoints) {
+    if (user == NULL || user->history == NULL || out == NULL || maxPoints <= 0) return 0;
+    NetWorthSeries* series = user->history;
+    RangeContext r = { field, from, to, out, maxPoints, 0 };
+    for (int b = firstBlockEndingAfter(series, from); b < series->blockCount && r.count < maxPoints; b++) {
+        if (series->blocks[b]->firstTime > to) break;
+        decodeBlock(series->blocks[b], collectRange, &r);
+    }
+    return r.count;
+}
+
+static time_t bucketStart(time_t when, SeriesBucketSize size) {
+    struct tm t = *localtime(&when);
+    t.tm_hour = t.tm_min = t.tm_sec = 0;
+    if (size == BUCKET_MONTHLY) t.tm_mday = 1;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+static time_t nextBucketStart(time_t start, SeriesBucketSize size) {
+    struct tm t = *localtime(&start);
+    if (size == BUCKET_MONTHLY) t.tm_mon++;
+    else t.tm_mday++;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+typedef struct GridContext {
+    SeriesField field;
+    time_t from, to;
+    const time_t* starts;
+    int bucketCount;
+    int index;
+    SeriesBucket* out;
+    int hasCarry;
+    double carry;
+} GridContext;
+
+static void addToBucket(SeriesBucket* b, double minV, double maxV, double last, int count) {
+    if (b->count == 0 || minV < b->min) b->min = minV;
+    if (b->count == 0 || maxV > b->max) b->max = maxV;
+    b->last = last;
+    b->count += count;
+}
+
+static void collectGrid(time_t when, const double* values, void* ctx) {
+    GridContext* g = (GridContext*)ctx;
+    if (when < g->from) {
+        g->hasCarry = 1;
+        g->carry = values[g->field];
+        return;
+    }
+    if (when > g->to) return;
+    while (g->index < g->bucketCount && when >= g->starts[g->index + 1]) g->index++;
+    if (g->index >= g->bucketCount) return;
+    double v = values[g->field];
+    addToBucket(&g->out[g->index], v, v, v, 1);
+}
+
+/* Blocks that sit entirely inside one bucket are merged from their header
+   summary without decoding. */
+static void downsampleIntoGrid(const NetWorthSeries* series, GridContext* g) {
+    int first = firstBlockEndingAfter(series, g->from);
+    if (first > 0) {
+        g->hasCarry = 1;
+        g->carry = series->blocks[first - 1]->last[g->field];
+    }
+    for (int b = first; b < series->blockCount; b++) {
+        const SeriesBlock* block = series->blocks[b];
+        if (block->firstTime > g->to) break;
+        while (g->index < g->bucketCount && block->firstTime >= g->starts[g->index + 1]) g->index++;
+        if (g->index < g->bucketCount && block->firstTime >= g->from && block->lastTime <= g->to &&
+            block->firstTime >= g->starts[g->index] && block->lastTime < g->starts[g->index + 1]) {
+            addToBucket(&g->out[g->index], block->min[g->field], block->max[g->field],
+                        block->last[g->field], block->count);
+            continue;
+        }
+        decodeBlock(block, collectGrid, g);
+    }
+}
+
+static int buildBucketGrid(time_t from, time_t to, SeriesBucketSize size, time_t* starts, int maxBuckets) {
+    int n = 0;
+    time_t start = bucketStart(from, size);
+    while (n < maxBuckets && start <= to) {
+        starts[n++] = start;
+        start = nextBucketStart(start, size);
+    }
+    starts[n] = start;
+    return n;
+}
+
+int querySeriesDownsampled(UserProfile* user, SeriesField field, time_t from, time_t to,
+                           SeriesBucketSize size, SeriesBucket* out, int maxBuckets) {
+    if (user == NULL || user->history == NULL || out == NULL || maxBuckets <= 0) return 0;
+
+    time_t* starts = (time_t*)malloc(sizeof(time_t) * (maxBuckets + 1));
+    SeriesBucket* grid = (SeriesBucket*)calloc(maxBuckets, sizeof(SeriesBucket));
+    if (starts == NULL || grid == NULL) { free(starts); free(grid); return 0; }
+
+    int bucketCount = buildBucketGrid(from, to, size, starts, maxBuckets);
+    for (int i = 0; i < bucketCount; i++) grid[i].start = starts[i];
+    GridContext g = { field, from, to, starts, bucketCount, 0, grid, 0, 0.0 };
+    downsampleIntoGrid(user->history, &g);
+
+    int n = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        if (grid[i].count > 0) out[n++] = grid[i];
+    }
+    free(starts);
+    free(grid);
+    return n;
+}
+
+/* System-wide trend: each bucket's last is the sum of every user's latest
+   value at the end of the bucket (carried forward through quiet buckets);
+   min and max are the sums of per-user extremes, i.e. bounds on the total. */
+int querySeriesDownsampledAll(UserHeap* heap, SeriesField field, time_t from, time_t to,
+                              SeriesBucketSize size, SeriesBucket* out, int maxBuckets) {
+    if (heap == NULL || out == NULL || maxBuckets <= 0) return 0;
+
+    time_t* starts = (time_t*)malloc(sizeof(time_t) * (maxBuckets + 1));
+    SeriesBucket* grid = (SeriesBucket*)malloc(sizeof(SeriesBucket) * maxBuckets);
+    if (starts == NULL || grid == NULL) { free(starts); free(grid); return 0; }
+
+    int bucketCount = buildBucketGrid(from, to, size, starts, maxBuckets);
+    for (int i = 0; i < bucketCount; i++) {
+        out[i].start = starts[i];
+        out[i].min = out[i].max = out[i].last = 0.0;
+        out[i].count = 0;
+    }
+
+    for (int u = 0; u < heap->size; u++) {
+        UserProfile* user = heap->userArray[u];
+        if (user == NULL || user->history == NULL) continue;
+        memset(grid, 0, sizeof(SeriesBucket) * bucketCount);
+        GridContext g = { field, from, to, starts, bucketCount, 0, grid, 0, 0.0 };
+        downsampleIntoGrid(user->history, &g);
+
+        int known = g.hasCarry;
+        double carry = g.carry;
+        for (int i = 0; i < bucketCount; i++) {
+            if (grid[i].count > 0) {
+                out[i].min += known ? (carry < grid[i].min ? carry : grid[i].min) : grid[i].min;
+                out[i].max += known ? (carry > grid[i].max ? carry : grid[i].max) : grid[i].max;
+                carry = grid[i].last;
+                known = 1;
+                out[i].count += grid[i].count;
+            } else if (known) {
+                out[i].min += carry;
+                out[i].max += carry;
+            }
+            if (known) out[i].last += carry;
+        }
+    }
+    free(starts);
+    free(grid);
+    return bucketCount;
+}
+
+time_t seriesFirstTime(UserProfile* user) {
+    if (user == NULL || user->history == NULL || user->history->blockCount == 0) return 0;
+    return user->history->blocks[0]->firstTime;
+}
+
+size_t seriesMemoryUsage(const NetWorthSeries* series) {
+    if (series == NULL) return 0;
+    size_t bytes = sizeof(NetWorthSeries) + sizeof(SeriesBlock*) * series->blockCapacity;
+    for (int i = 0; i < series->blockCount; i++) {
+        bytes += sizeof(SeriesBlock) + series->blocks[i]->byteCapacity;
+    }
+    return bytes;
+}
+
+void freeNetWorthSeries(NetWorthSeries* series) {
+    if (series == NULL) return;
+    for (int i = 0; i < series->blockCount; i++) free(series->blocks[i]);
+    free(series->blocks);
+    free(series);
+}
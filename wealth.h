@@ -6,6 +6,7 @@
 #include <string.h>
 #include <time.h>
 #include <math.h> 
+#include <sys/types.h>
 
 typedef enum InvestmentType {
     INV_NONE,
@@ -22,19 +23,232 @@ typedef struct ExpenditureNode {
     time_t date;
     InvestmentType investmentType;
     struct ExpenditureNode* next;
+    struct ExpenditureNode* prev;
 } ExpenditureNode;
 
+#define COMPACTION_DEFAULT_HORIZON (180L * 24 * 60 * 60)
+#define COMPACTION_STEP_BUDGET 64
+#define COLD_LOG_IDLE_SECONDS (30L * 24 * 60 * 60)
+#define COLD_LOG_DICT_MAX 4096
+
+typedef struct ColdLog {
+    unsigned char* bytes;
+    size_t length;
+    size_t capacity;
+    size_t start;
+    int count;
+    time_t baseDate;
+    time_t lastDate;
+    time_t oldestDate;
+} ColdLog;
+
+typedef struct ExpenseCursor {
+    const ExpenditureNode* hot;
+    const ColdLog* cold;
+    size_t offset;
+    int remaining;
+    time_t nextDate;
+    ExpenditureNode scratch;
+} ExpenseCursor;
+
+typedef struct ExpenseRollup {
+    int period;
+    char category[50];
+    char ticker[50];
+    InvestmentType investmentType;
+    double amount;
+    int count;
+    struct ExpenseRollup* next;
+} ExpenseRollup;
+
+#define LOT_CHUNK_SIZE 16
+#define LOT_UNIT_EPSILON 1e-9
+
+typedef enum CostMethod {
+    COST_FIFO,
+    COST_AVERAGE
+} CostMethod;
+
+typedef struct Lot {
+    double units;
+    double unitCost;
+    time_t date;
+} Lot;
+
+typedef struct LotChunk {
+    Lot lots[LOT_CHUNK_SIZE];
+    int next;
+} LotChunk;
+
+typedef struct LotQueue {
+    int headChunk;
+    int headPos;
+    int tailChunk;
+    int tailCount;
+    int lotCount;
+    CostMethod method;
+    double totalUnits;
+    double totalCost;
+    double realizedGain;
+} LotQueue;
+
+typedef struct LotCursor {
+    const LotQueue* queue;
+    int chunk;
+    int pos;
+} LotCursor;
+
 typedef struct WealthNode {
     char name[50];
     double value;
     double interestRate;
+    int currencyId;
+    int fxSlot;
+    LotQueue* lots;
+    int firstRule;
+    struct WealthNode* parent;
     struct WealthNode* firstChild;
     struct WealthNode* nextSibling;
 } WealthNode;
 
 struct UserProfile;
 
+#define ALERT_INBOX_SIZE 16
+
+typedef enum AlertKind {
+    ALERT_MONTHLY_SPEND_ABOVE,
+    ALERT_SINGLE_EXPENSE_ABOVE,
+    ALERT_NET_WORTH_DROP
+} AlertKind;
+
+typedef struct AlertRule {
+    struct UserProfile* user;
+    WealthNode* node;
+    AlertKind kind;
+    double threshold;
+    double reference;
+    int period;
+    int fired;
+    int nextOnNode;
+    int nextOnUser;
+} AlertRule;
+
+typedef struct AlertInbox {
+    char messages[ALERT_INBOX_SIZE][120];
+    int count;
+    int next;
+    int unread;
+} AlertInbox;
+
+#define SERIES_BLOCK_BYTES 2048
+
+typedef enum SeriesField {
+    SERIES_NET_WORTH,
+    SERIES_INCOME,
+    SERIES_EXPENSES,
+    SERIES_INVESTMENTS,
+    SERIES_FIELD_COUNT
+} SeriesField;
+
+typedef enum SeriesBucketSize {
+    BUCKET_DAILY,
+    BUCKET_MONTHLY
+} SeriesBucketSize;
+
+typedef struct SeriesBlock {
+    time_t firstTime;
+    time_t lastTime;
+    int count;
+    int bitLength;
+    int byteCapacity;
+    double first[SERIES_FIELD_COUNT];
+    double min[SERIES_FIELD_COUNT];
+    double max[SERIES_FIELD_COUNT];
+    double last[SERIES_FIELD_COUNT];
+    unsigned char bits[];
+} SeriesBlock;
+
+typedef struct NetWorthSeries {
+    SeriesBlock** blocks;
+    int blockCount;
+    int blockCapacity;
+    long long pointCount;
+    long long prevDelta;
+} NetWorthSeries;
+
+typedef struct SeriesPoint {
+    time_t time;
+    double value;
+} SeriesPoint;
+
+typedef struct SeriesBucket {
+    time_t start;
+    double min;
+    double max;
+    double last;
+    int count;
+} SeriesBucket;
+
+#define TIMER_TICK_SECONDS 60
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+typedef enum ScheduleKind {
+    SCHED_INCOME,
+    SCHED_STOCK_SIP,
+    SCHED_EXPENSE
+} ScheduleKind;
+
+typedef enum ScheduleInterval {
+    EVERY_WEEK,
+    EVERY_MONTH,
+    EVERY_QUARTER
+} ScheduleInterval;
+
+typedef struct RecurringSchedule {
+    struct UserProfile* user;
+    ScheduleKind kind;
+    ScheduleInterval interval;
+    char target[50];
+    char description[100];
+    double amount;
+    time_t nextDue;
+    int anchorDay;
+    int wheelLevel;
+    int wheelSlot;
+    struct RecurringSchedule* wheelPrev;
+    struct RecurringSchedule* wheelNext;
+    struct RecurringSchedule* userNext;
+} RecurringSchedule;
+
+#define FX_BASE_CURRENCY "INR"
+#define FX_MAX_CURRENCIES 32
+
+/* Holdings priced in one currency, kept as parallel arrays so a rate
+   change revalues all of them in a single pass. */
+typedef struct FxCurrency {
+    char code[4];
+    double rate;
+    double* nativeValue;
+    double* baseValue;
+    double* delta;
+    WealthNode** nodes;
+    struct UserProfile** owners;
+    int count;
+    int capacity;
+} FxCurrency;
+
+#define HEAP_ARITY 4
+
+typedef struct HeapEntry {
+    double netWorth;
+    int userId;
+} HeapEntry;
+
 typedef struct UserHeap {
+    HeapEntry* entries;
+    int* position;
     struct UserProfile** userArray;
     int size;
     int capacity;
@@ -43,40 +257,186 @@ typedef struct UserHeap {
 typedef struct UserProfile {
     char name[50];
     double netWorth;
+    int heapId;
+    int pendingFinalize;
     WealthNode* wealthTreeRoot;
     ExpenditureNode* expenseListHead;
+    ExpenditureNode* expenseListTail;
+    ColdLog* coldLog;
+    time_t lastAccess;
+    ExpenseRollup* rollupListHead;
+    RecurringSchedule* scheduleListHead;
+    NetWorthSeries* history;
+    int firstAlertRule;
+    AlertInbox* alertInbox;
 } UserProfile;
 
 extern UserHeap* g_userHeap;
+extern long g_clockOffset;
+extern int g_engineQuiet;
+extern long g_compactionHorizon;
+extern FxCurrency g_fxCurrencies[FX_MAX_CURRENCIES];
+extern int g_fxCurrencyCount;
 
 WealthNode* createWealthNode(const char* name, double value);
 void addWealthChild(WealthNode* parent, WealthNode* newChild);
 WealthNode* findWealthNode(WealthNode* root, const char* name);
+WealthNode* findStockHolding(UserProfile* user, const char* ticker);
 
 UserHeap* createHeap(int capacity);
 void swapUsers(UserHeap* heap, int i, int j);
 void heapifyUp(UserHeap* heap, int index);
 void heapifyDown(UserHeap* heap, int index);
 void heapInsert(UserHeap* heap, UserProfile* user);
+void heapUpdateKey(UserHeap* heap, UserProfile* user);
+void heapRemoveUser(UserHeap* heap, UserProfile* user);
 UserProfile* getTopWealthUser(UserHeap* heap);
+int heapTopK(UserHeap* heap, int k, UserProfile** out);
 int findUserIndex(UserHeap* heap, UserProfile* user);
 void displayHeap(UserHeap* heap); 
+void displayHeapInCurrency(UserHeap* heap, int currencyId);
 
 double recursiveUpdateAndGetWorth(WealthNode* root); 
 double calculateProjectedNetWorth(WealthNode* root, int years);
 void logExpenseToList(UserProfile* user, const char* category, const char* desc, double amount, InvestmentType invType);
 void manageStock(UserProfile* user, const char* ticker, double amount, double rate, int isAdding);
 void manageAsset(UserProfile* user, const char* assetName, double amount, double rate, int isAdding);
+int manageStockInCurrency(UserProfile* user, const char* ticker, double amount, double rate, int isAdding, const char* currency);
+int manageAssetInCurrency(UserProfile* user, const char* assetName, double amount, double rate, int isAdding, const char* currency);
 void setWealthNodeValue(UserProfile* user, const char* nodeName, double newValue);
 void updateExpenseCategoryTotal(UserProfile* user, const char* category, double amount);
 void finalizeUserUpdates(UserProfile* user);
+void beginUpdateBatch(void);
+void endUpdateBatch(void);
+int inUpdateBatch(void);
+time_t engineNow(void);
+void pinEngineClock(time_t when);
+void setEngineEpoch(time_t epoch);
+UserProfile* createUserProfile(const char* name);
 void registerNewUser(const char* name);
+void unregisterUser(UserProfile* user);
 
-void printExpenseLog(ExpenditureNode* head);
+void printExpenseLog(UserProfile* user);
 void printWealthTree(WealthNode* root, int indent);
 void freeExpenseList(ExpenditureNode* head);
 void freeWealthTree(WealthNode* root);
 void freeHeap(UserHeap* heap);
 
+int compactExpenseLog(UserProfile* user, time_t cutoff, int budget);
+int runCompactionStep(UserHeap* heap, int budget);
+void forgetCompactionCursor(UserProfile* user);
+void printExpenseRollups(ExpenseRollup* head);
+void freeExpenseRollups(ExpenseRollup* head);
+
+ColdLog* createColdLog(void);
+int coldLogAppend(ColdLog* log, const ExpenditureNode* entry);
+void finishColdLog(ColdLog* log);
+void freeColdLog(ColdLog* log);
+int coldLogOldest(const ColdLog* log, ExpenditureNode* out);
+void coldLogDropOldest(ColdLog* log);
+void openExpenseCursor(ExpenseCursor* cursor, const ExpenditureNode* hot, const ColdLog* cold);
+const ExpenditureNode* nextExpense(ExpenseCursor* cursor);
+int freezeExpenseLog(UserProfile* user, int budget);
+size_t coldLogMemoryUsage(const ColdLog* log);
+void printColdStorageReport(UserHeap* heap);
+void freeColdLogDictionary(void);
+int coldLogDictionarySize(void);
+const char* coldLogDictionaryString(int id);
+int restoreColdLogString(const char* s, int id);
+int coldLogValid(const ColdLog* log);
+
+int fxFindCurrency(const char* code);
+const char* fxCurrencyCode(int currencyId);
+double fxConvertToBase(double amount, int currencyId);
+double fxConvertFromBase(double amount, int currencyId);
+int fxSetRate(const char* code, double rate);
+int fxRegisterHolding(UserProfile* owner, WealthNode* node, int currencyId);
+void fxUnregisterHolding(WealthNode* node);
+double fxHoldingNativeValue(const WealthNode* node);
+void fxSetHoldingNativeValue(WealthNode* node, double nativeValue);
+void fxFreeTables(void);
+
+RecurringSchedule* addRecurringSchedule(UserProfile* user, ScheduleKind kind, ScheduleInterval interval,
+                                        const char* target, const char* description, double amount, time_t firstDue);
+void cancelRecurringSchedule(RecurringSchedule* schedule);
+void cancelUserSchedules(UserProfile* user);
+int runDueSchedules(time_t now);
+int advanceEngineClock(long seconds);
+void printUserSchedules(UserProfile* user);
+
+int buyStockLots(UserProfile* user, const char* ticker, double units, double price, double rate, const char* currency);
+int sellStockLots(UserProfile* user, const char* ticker, double units, double price, double* realizedOut);
+void setHoldingCostMethod(WealthNode* node, CostMethod method);
+void openLotCursor(LotCursor* cursor, const LotQueue* q);
+const Lot* nextLot(LotCursor* cursor);
+int restoreLot(WealthNode* node, double units, double unitCost, time_t date);
+void freeLotQueue(LotQueue* q);
+void freeLotPool(void);
+
+int addAlertRule(UserProfile* user, AlertKind kind, const char* category, double threshold);
+int removeAlertRule(UserProfile* user, int position);
+void cancelUserAlerts(UserProfile* user);
+void evaluateNodeRules(WealthNode* node, double delta);
+void printUserAlertRules(UserProfile* user);
+void printAlertInbox(UserProfile* user);
+void freeAlertPool(void);
+
+typedef struct PortfolioRow {
+    char name[50];
+    const WealthNode* holding;
+    int isStock;
+    double cost;
+    double market;
+    double realized;
+} PortfolioRow;
+
+double getCostBasis(UserProfile* user, const char* name);
+PortfolioRow* buildPortfolio(UserProfile* user, int* countOut, PortfolioRow* total);
+
+#define SNAPSHOT_DEFAULT_PATH "wealth.snapshot"
+#define SNAPSHOT_PATH_MAX 256
+#define AUTOSAVE_INTERVAL_SECONDS 30
+
+int saveSnapshot(const char* path);
+int loadSnapshot(const char* path);
+void lockEngine(void);
+void unlockEngine(void);
+int startAutosave(const char* path, int intervalSeconds);
+void stopAutosave(void);
+
+typedef struct ShardCluster {
+    int count;
+    pid_t* pids;
+    int* fds;
+} ShardCluster;
+
+typedef struct ShardEntry {
+    char name[50];
+    double netWorth;
+    int shard;
+} ShardEntry;
+
+ShardCluster* startShards(int count);
+void stopShards(ShardCluster* cluster);
+int shardForName(const ShardCluster* cluster, const char* name);
+int shardRegisterUser(ShardCluster* cluster, const char* name);
+int shardRemoveUser(ShardCluster* cluster, const char* name);
+int shardAddIncome(ShardCluster* cluster, const char* name, double amount, double* netWorth);
+int shardAddExpense(ShardCluster* cluster, const char* name, const char* category, const char* description,
+                    double amount, double* netWorth);
+long shardUserCount(ShardCluster* cluster);
+int shardTopK(ShardCluster* cluster, int k, ShardEntry* out);
+int shardTopUser(ShardCluster* cluster, ShardEntry* out);
+
+void recordNetWorthSample(UserProfile* user);
+int querySeriesRange(UserProfile* user, SeriesField field, time_t from, time_t to, SeriesPoint* out, int maxPoints);
+int querySeriesDownsampled(UserProfile* user, SeriesField field, time_t from, time_t to,
+                           SeriesBucketSize size, SeriesBucket* out, int maxBuckets);
+int querySeriesDownsampledAll(UserHeap* heap, SeriesField field, time_t from, time_t to,
+                              SeriesBucketSize size, SeriesBucket* out, int maxBuckets);
+time_t seriesFirstTime(UserProfile* user);
+size_t seriesMemoryUsage(const NetWorthSeries* series);
+void freeNetWorthSeries(NetWorthSeries* series);
+
 
 #endif 
\ No newline at end of file
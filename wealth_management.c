@@ -6,6 +6,31 @@
 #include <math.h> 
 
 UserHeap* g_userHeap = NULL;
+long g_clockOffset = 0;
+int g_engineQuiet = 0;
+
+static time_t g_pinnedTime = 0;
+static time_t g_engineEpoch = 0;
+static int g_updateBatchDepth = 0;
+static UserProfile** g_batchUsers = NULL;
+static int g_batchCount = 0;
+static int g_batchCapacity = 0;
+
+time_t engineNow(void) {
+    if (g_pinnedTime != 0) return g_pinnedTime;
+    if (g_engineEpoch != 0) return g_engineEpoch + g_clockOffset;
+    return time(NULL) + g_clockOffset;
+}
+
+/* Detaches the engine from the wall clock: time starts at `epoch` and only
+   moves through advanceEngineClock. 0 follows the wall clock again. */
+void setEngineEpoch(time_t epoch) {
+    g_engineEpoch = epoch;
+}
+
+void pinEngineClock(time_t when) {
+    g_pinnedTime = when;
+}
 
 WealthNode* createWealthNode(const char* name, double value) {
     WealthNode* newNode = (WealthNode*)malloc(sizeof(WealthNode));
@@ -17,6 +42,11 @@ WealthNode* createWealthNode(const char* name, double value) {
     newNode->name[49] = '\0';
     newNode->value = value;
     newNode->interestRate = 0.0;
+    newNode->currencyId = 0;
+    newNode->fxSlot = -1;
+    newNode->lots = NULL;
+    newNode->firstRule = -1;
+    newNode->parent = NULL;
     newNode->firstChild = NULL;
     newNode->nextSibling = NULL;
     return newNode;
@@ -26,6 +56,7 @@ void addWealthChild(WealthNode* parent, WealthNode* newChild) {
     if (parent == NULL || newChild == NULL){ 
         return; 
     }
+    newChild->parent = parent;
     if (parent->firstChild == NULL) {
         parent->firstChild = newChild;
     } else {
@@ -51,6 +82,19 @@ WealthNode* findWealthNode(WealthNode* root, const char* name) {
     return findWealthNode(root->nextSibling, name);
 }
 
+/* Holdings are the direct children of the stock category. findWealthNode
+   would also search the category's siblings, so a ticker named like a
+   general asset could resolve to it. */
+WealthNode* findStockHolding(UserProfile* user, const char* ticker) {
+    if (user == NULL || user->wealthTreeRoot == NULL || ticker == NULL) return NULL;
+    WealthNode* stockCategory = findWealthNode(user->wealthTreeRoot, "stock");
+    if (stockCategory == NULL) return NULL;
+    for (WealthNode* holding = stockCategory->firstChild; holding != NULL; holding = holding->nextSibling) {
+        if (strcmp(holding->name, ticker) == 0) return holding;
+    }
+    return NULL;
+}
+
 void printWealthTree(WealthNode* root, int indent) {
     if (root == NULL) {
         return; 
@@ -58,11 +102,14 @@ void printWealthTree(WealthNode* root, int indent) {
     for (int i = 0; i < indent; i++) {
         printf("  "); 
     }
+    printf("+- %s: (Rs.%.2f)", root->name, root->value);
+    if (root->fxSlot >= 0) {
+        printf(" [%s %.2f]", fxCurrencyCode(root->currencyId), fxHoldingNativeValue(root));
+    }
     if (root->interestRate > 0.0) {
-        printf("+- %s: (Rs.%.2f) [Rate: %.1f%%]\n", root->name, root->value, root->interestRate);
-    } else {
-        printf("+- %s: (Rs.%.2f)\n", root->name, root->value);
+        printf(" [Rate: %.1f%%]", root->interestRate);
     }
+    printf("\n");
     printWealthTree(root->firstChild, indent + 2); 
     printWealthTree(root->nextSibling, indent);
 }
@@ -74,18 +121,16 @@ void freeWealthTree(WealthNode* root) {
     }
     freeWealthTree(root->firstChild);
     freeWealthTree(root->nextSibling);
+    fxUnregisterHolding(root);
+    freeLotQueue(root->lots);
     free(root);
 }
 
-static int userCompare(const UserProfile* a, const UserProfile* b) {
-    if (a == NULL && b == NULL) return 0;
-    if (a == NULL) return -1;
-    if (b == NULL) return 1;
-
+static int entryCompare(const UserHeap* heap, const HeapEntry* a, const HeapEntry* b) {
     if (a->netWorth > b->netWorth) return 1;
     if (a->netWorth < b->netWorth) return -1;
 
-    int cmp = strcmp(a->name, b->name);
+    int cmp = strcmp(heap->userArray[a->userId]->name, heap->userArray[b->userId]->name);
     if (cmp < 0) return 1;
     if (cmp > 0) return -1;
     return 0;
@@ -95,27 +140,55 @@ UserHeap* createHeap(int capacity) {
     if (capacity <= 0) capacity = 1;
     UserHeap* heap = (UserHeap*)malloc(sizeof(UserHeap));
     if (heap == NULL) return NULL;
+    heap->entries = (HeapEntry*)malloc(sizeof(HeapEntry) * capacity);
+    heap->position = (int*)malloc(sizeof(int) * capacity);
     heap->userArray = (UserProfile**)malloc(sizeof(UserProfile*) * capacity);
-    if (heap->userArray == NULL) { free(heap); return NULL; }
+    if (heap->entries == NULL || heap->position == NULL || heap->userArray == NULL) {
+        free(heap->entries);
+        free(heap->position);
+        free(heap->userArray);
+        free(heap);
+        return NULL;
+    }
     for (int i = 0; i < capacity; i++) heap->userArray[i] = NULL;
     heap->size = 0;
     heap->capacity = capacity;
     return heap;
 }
 
+static int growHeap(UserHeap* heap) {
+    int newCap = heap->capacity * 2;
+    if (newCap == 0) newCap = 10;
+    HeapEntry* newEntries = (HeapEntry*)realloc(heap->entries, sizeof(HeapEntry) * newCap);
+    if (newEntries == NULL) return 0;
+    heap->entries = newEntries;
+    int* newPos = (int*)realloc(heap->position, sizeof(int) * newCap);
+    if (newPos == NULL) return 0;
+    heap->position = newPos;
+    UserProfile** newArr =
+        (UserProfile**)realloc(heap->userArray, sizeof(UserProfile*) * newCap);
+    if (newArr == NULL) return 0;
+    for (int i = heap->capacity; i < newCap; i++) newArr[i] = NULL;
+    heap->userArray = newArr;
+    heap->capacity = newCap;
+    return 1;
+}
+
 void swapUsers(UserHeap* heap, int i, int j) {
-    if (heap == NULL || heap->userArray == NULL) return;
+    if (heap == NULL || heap->entries == NULL) return;
     if (i < 0 || j < 0 || i >= heap->size || j >= heap->size) return;
-    UserProfile* temp = heap->userArray[i];
-    heap->userArray[i] = heap->userArray[j];
-    heap->userArray[j] = temp;
+    HeapEntry temp = heap->entries[i];
+    heap->entries[i] = heap->entries[j];
+    heap->entries[j] = temp;
+    heap->position[heap->entries[i].userId] = i;
+    heap->position[heap->entries[j].userId] = j;
 }
 
 void heapifyUp(UserHeap* heap, int index) {
-    if (heap == NULL || heap->userArray == NULL) return;
+    if (heap == NULL || heap->entries == NULL) return;
     while (index > 0) {
-        int parent = (index - 1) / 2;
-        if (userCompare(heap->userArray[index], heap->userArray[parent]) > 0) {
+        int parent = (index - 1) / HEAP_ARITY;
+        if (entryCompare(heap, &heap->entries[index], &heap->entries[parent]) > 0) {
             swapUsers(heap, index, parent);
             index = parent;
         } else {
@@ -125,18 +198,16 @@ void heapifyUp(UserHeap* heap, int index) {
 }
 
 void heapifyDown(UserHeap* heap, int index) {
-    if (heap == NULL || heap->userArray == NULL) return;
+    if (heap == NULL || heap->entries == NULL) return;
     while (1) {
-        int left = index * 2 + 1;
-        int right = index * 2 + 2;
+        int first = index * HEAP_ARITY + 1;
+        int last = first + HEAP_ARITY;
+        if (last > heap->size) last = heap->size;
         int largest = index;
-        if (left < heap->size &&
-            userCompare(heap->userArray[left], heap->userArray[largest]) > 0) {
-            largest = left;
-        }
-        if (right < heap->size &&
-            userCompare(heap->userArray[right], heap->userArray[largest]) > 0) {
-            largest = right;
+        for (int child = first; child < last; child++) {
+            if (entryCompare(heap, &heap->entries[child], &heap->entries[largest]) > 0) {
+                largest = child;
+            }
         }
         if (largest != index) {
             swapUsers(heap, index, largest);
@@ -148,44 +219,136 @@ void heapifyDown(UserHeap* heap, int index) {
 }
 
 void heapInsert(UserHeap* heap, UserProfile* user) {
-    if (heap == NULL || heap->userArray == NULL || user == NULL) return;
-    if (heap->size >= heap->capacity) {
-        int newCap = heap->capacity * 2;
-        if (newCap == 0) newCap = 10;
-        UserProfile** newArr =
-            (UserProfile**)realloc(heap->userArray, sizeof(UserProfile*) * newCap);
-        if (newArr == NULL) return;
-        for (int i = heap->capacity; i < newCap; i++) newArr[i] = NULL;
-        heap->userArray = newArr;
-        heap->capacity = newCap;
-    }
-    heap->userArray[heap->size] = user;
-    heapifyUp(heap, heap->size);
+    if (heap == NULL || heap->entries == NULL || user == NULL) return;
+    if (heap->size >= heap->capacity && !growHeap(heap)) return;
+
+    int id = heap->size;
+    heap->userArray[id] = user;
+    user->heapId = id;
+    heap->entries[heap->size].netWorth = user->netWorth;
+    heap->entries[heap->size].userId = id;
+    heap->position[id] = heap->size;
     heap->size++;
+    heapifyUp(heap, heap->size - 1);
+}
+
+void heapUpdateKey(UserHeap* heap, UserProfile* user) {
+    int index = findUserIndex(heap, user);
+    if (index == -1) return;
+
+    double oldNetWorth = heap->entries[index].netWorth;
+    heap->entries[index].netWorth = user->netWorth;
+    if (user->netWorth > oldNetWorth) {
+        heapifyUp(heap, index);
+    } else if (user->netWorth < oldNetWorth) {
+        heapifyDown(heap, index);
+    }
+}
+
+/* Ids stay dense so userArray can still be walked from 0 to size: the
+   highest id is renumbered into the slot the removed user vacates. */
+void heapRemoveUser(UserHeap* heap, UserProfile* user) {
+    int index = findUserIndex(heap, user);
+    if (index == -1) return;
+
+    int lastIndex = heap->size - 1;
+    swapUsers(heap, index, lastIndex);
+    heap->size--;
+    if (index < heap->size) {
+        int movedId = heap->entries[index].userId;
+        heapifyUp(heap, index);
+        heapifyDown(heap, heap->position[movedId]);
+    }
+
+    int id = user->heapId;
+    int lastId = heap->size;
+    if (id != lastId) {
+        UserProfile* moved = heap->userArray[lastId];
+        heap->userArray[id] = moved;
+        moved->heapId = id;
+        heap->position[id] = heap->position[lastId];
+        heap->entries[heap->position[id]].userId = id;
+    }
+    heap->userArray[lastId] = NULL;
+    user->heapId = -1;
 }
 
 UserProfile* getTopWealthUser(UserHeap* heap) {
-    if (heap == NULL || heap->userArray == NULL || heap->size <= 0) return NULL;
-    return heap->userArray[0];
+    if (heap == NULL || heap->entries == NULL || heap->size <= 0) return NULL;
+    return heap->userArray[heap->entries[0].userId];
+}
+
+/* Best-first walk of the heap: the next-ranked user is always a child of one
+   already emitted, so only the frontier (at most (HEAP_ARITY-1)*k+1 slots)
+   is kept in a small heap of its own. O(k log k), independent of size. */
+int heapTopK(UserHeap* heap, int k, UserProfile** out) {
+    if (heap == NULL || heap->entries == NULL || out == NULL || k <= 0 || heap->size <= 0) return 0;
+    if (k > heap->size) k = heap->size;
+
+    int* frontier = (int*)malloc(sizeof(int) * ((HEAP_ARITY - 1) * k + 1));
+    if (frontier == NULL) return 0;
+    int frontierSize = 1;
+    frontier[0] = 0;
+
+    int count = 0;
+    while (count < k && frontierSize > 0) {
+        int best = frontier[0];
+        out[count++] = heap->userArray[heap->entries[best].userId];
+
+        frontier[0] = frontier[--frontierSize];
+        for (int i = 0;;) {
+            int largest = i;
+            int left = 2 * i + 1, right = 2 * i + 2;
+            if (left < frontierSize &&
+                entryCompare(heap, &heap->entries[frontier[left]], &heap->entries[frontier[largest]]) > 0) largest = left;
+            if (right < frontierSize &&
+                entryCompare(heap, &heap->entries[frontier[right]], &heap->entries[frontier[largest]]) > 0) largest = right;
+            if (largest == i) break;
+            int temp = frontier[i]; frontier[i] = frontier[largest]; frontier[largest] = temp;
+            i = largest;
+        }
+
+        int first = best * HEAP_ARITY + 1;
+        for (int child = first; child < first + HEAP_ARITY && child < heap->size; child++) {
+            int i = frontierSize++;
+            frontier[i] = child;
+            while (i > 0) {
+                int parent = (i - 1) / 2;
+                if (entryCompare(heap, &heap->entries[frontier[i]], &heap->entries[frontier[parent]]) <= 0) break;
+                int temp = frontier[i]; frontier[i] = frontier[parent]; frontier[parent] = temp;
+                i = parent;
+            }
+        }
+    }
+    free(frontier);
+    return count;
 }
 
 int findUserIndex(UserHeap* heap, UserProfile* user) {
     if (heap == NULL || user == NULL || heap->userArray == NULL) return -1;
-    for (int i = 0; i < heap->size; i++) {
-        if (heap->userArray[i] == user) return i;
-    }
-    return -1;
+    if (user->heapId < 0 || user->heapId >= heap->size) return -1;
+    if (heap->userArray[user->heapId] != user) return -1;
+    return heap->position[user->heapId];
 }
 
 void displayHeap(UserHeap* heap) {
+    displayHeapInCurrency(heap, 0);
+}
+
+void displayHeapInCurrency(UserHeap* heap, int currencyId) {
     if (heap == NULL || heap->size == 0) {
         printf("\nNo users in the system to display.\n");
         return;
     }
     printf("\n----- ALL USERS -----\n");
     for (int i = 0; i < heap->size; i++) {
-        if (heap->userArray[i] != NULL) {
-            printf("%d. Name: %s, Net Worth: Rs.%.2f\n", i + 1, heap->userArray[i]->name, heap->userArray[i]->netWorth);
+        UserProfile* user = heap->userArray[heap->entries[i].userId];
+        if (user == NULL) continue;
+        if (currencyId == 0) {
+            printf("%d. Name: %s, Net Worth: Rs.%.2f\n", i + 1, user->name, user->netWorth);
+        } else {
+            printf("%d. Name: %s, Net Worth: %s %.2f\n", i + 1, user->name,
+                   fxCurrencyCode(currencyId), fxConvertFromBase(user->netWorth, currencyId));
         }
     }
 }
@@ -230,8 +393,42 @@ double calculateProjectedNetWorth(WealthNode* root, int years) {
     return childrenSum;
 }
 
+void beginUpdateBatch(void) {
+    g_updateBatchDepth++;
+}
+
+void endUpdateBatch(void) {
+    if (g_updateBatchDepth == 0 || --g_updateBatchDepth > 0) return;
+    for (int i = 0; i < g_batchCount; i++) {
+        g_batchUsers[i]->pendingFinalize = 0;
+        finalizeUserUpdates(g_batchUsers[i]);
+    }
+    g_batchCount = 0;
+}
+
+int inUpdateBatch(void) {
+    return g_updateBatchDepth > 0;
+}
+
+static int deferFinalize(UserProfile* user) {
+    if (user->pendingFinalize) return 1;
+    if (g_batchCount >= g_batchCapacity) {
+        int newCap = g_batchCapacity ? g_batchCapacity * 2 : 64;
+        UserProfile** grown = (UserProfile**)realloc(g_batchUsers, sizeof(UserProfile*) * newCap);
+        if (grown == NULL) return 0;
+        g_batchUsers = grown;
+        g_batchCapacity = newCap;
+    }
+    user->pendingFinalize = 1;
+    g_batchUsers[g_batchCount++] = user;
+    return 1;
+}
+
+/* Inside an update batch the recompute is deferred to endUpdateBatch, so a
+   user touched many times in one batch is only finalized once. */
 void finalizeUserUpdates(UserProfile* user) {
     if (user == NULL || g_userHeap == NULL) return;
+    if (g_updateBatchDepth > 0 && deferFinalize(user)) return;
     
     double oldNetWorth = user->netWorth;
     if (user->wealthTreeRoot != NULL) {
@@ -239,14 +436,37 @@ void finalizeUserUpdates(UserProfile* user) {
         user->wealthTreeRoot->value = user->netWorth;
     }
 
-    int userIndex = findUserIndex(g_userHeap, user);
-    if (userIndex == -1) return;
+    if (user->netWorth != oldNetWorth) {
+        heapUpdateKey(g_userHeap, user);
+        if (user->wealthTreeRoot != NULL && user->wealthTreeRoot->firstRule != -1) {
+            evaluateNodeRules(user->wealthTreeRoot, user->netWorth - oldNetWorth);
+        }
+    }
+    recordNetWorthSample(user);
+}
 
-    if (user->netWorth > oldNetWorth) {
-        heapifyUp(g_userHeap, userIndex);
-    } else if (user->netWorth < oldNetWorth) {
-        heapifyDown(g_userHeap, userIndex);
+static void freeUserProfile(UserProfile* user) {
+    forgetCompactionCursor(user);
+    cancelUserSchedules(user);
+    cancelUserAlerts(user);
+    freeNetWorthSeries(user->history);
+    user->history = NULL;
+    if (user->wealthTreeRoot != NULL) {
+        freeWealthTree(user->wealthTreeRoot);
+        user->wealthTreeRoot = NULL;
+    }
+    if (user->expenseListHead != NULL) {
+        freeExpenseList(user->expenseListHead);
+        user->expenseListHead = NULL;
+        user->expenseListTail = NULL;
     }
+    freeColdLog(user->coldLog);
+    user->coldLog = NULL;
+    if (user->rollupListHead != NULL) {
+        freeExpenseRollups(user->rollupListHead);
+        user->rollupListHead = NULL;
+    }
+    free(user);
 }
 
 void freeHeap(UserHeap* heap) {
@@ -255,22 +475,28 @@ void freeHeap(UserHeap* heap) {
         for (int i = 0; i < heap->size; i++) {
             UserProfile* user = heap->userArray[i];
             if (user == NULL) continue;
-            if (user->wealthTreeRoot != NULL) {
-                freeWealthTree(user->wealthTreeRoot);
-                user->wealthTreeRoot = NULL;
-            }
-            if (user->expenseListHead != NULL) {
-                freeExpenseList(user->expenseListHead);
-                user->expenseListHead = NULL;
-            }
-            free(user);
+            freeUserProfile(user);
             heap->userArray[i] = NULL;
         }
         free(heap->userArray);
         heap->userArray = NULL;
     }
+    free(heap->entries);
+    free(heap->position);
     free(heap);
-    if (heap == g_userHeap) g_userHeap = NULL;
+    if (heap == g_userHeap) {
+        g_userHeap = NULL;
+        free(g_batchUsers);
+        g_batchUsers = NULL;
+        g_batchCount = g_batchCapacity = 0;
+    }
+}
+
+void unregisterUser(UserProfile* user) {
+    if (user == NULL || g_userHeap == NULL) return;
+    if (findUserIndex(g_userHeap, user) == -1) return;
+    heapRemoveUser(g_userHeap, user);
+    freeUserProfile(user);
 }
 
 void logExpenseToList(UserProfile* user, const char* category, const char* desc, double amount, InvestmentType invType) {
@@ -288,22 +514,73 @@ void logExpenseToList(UserProfile* user, const char* category, const char* desc,
     
     newNode->amount = amount;
     newNode->investmentType = invType; 
-    newNode->date = time(NULL); 
+    newNode->date = engineNow(); 
     
+    newNode->prev = NULL;
     newNode->next = user->expenseListHead;
+    if (user->expenseListHead != NULL) {
+        user->expenseListHead->prev = newNode;
+    } else {
+        user->expenseListTail = newNode;
+    }
     user->expenseListHead = newNode;
 }
 
-void manageStock(UserProfile* user, const char* ticker, double amount, double rate, int isAdding) {
-    if (!user || !user->wealthTreeRoot) return;
+/* A NULL currency means "whatever the holding is already in", or the base
+   currency for a new holding. Amounts are in the holding's currency. */
+static int resolveHoldingCurrency(UserProfile* user, WealthNode* node, const char* currency) {
+    int currencyId = node->currencyId;
+    if (currency != NULL && currency[0] != '\0') {
+        currencyId = fxFindCurrency(currency);
+        if (currencyId == -1) {
+            printf("Error: Unknown currency '%s'. Ask the admin to set its FX rate first.\n", currency);
+            return -1;
+        }
+    }
+    if (currencyId == node->currencyId) return currencyId;
+
+    if (node->fxSlot >= 0 || node->value != 0.0) {
+        printf("Error: '%s' is held in %s and cannot be changed to %s.\n",
+               node->name, fxCurrencyCode(node->currencyId), fxCurrencyCode(currencyId));
+        return -1;
+    }
+    if (!fxRegisterHolding(user, node, currencyId)) return -1;
+    return currencyId;
+}
+
+static void applyHoldingChange(WealthNode* node, double amount, double rate, int isAdding) {
+    double nativeValue = fxHoldingNativeValue(node);
+    if (isAdding) {
+        nativeValue += amount;
+    } else {
+        nativeValue = amount;
+    }
+    fxSetHoldingNativeValue(node, nativeValue);
+
+    if (rate >= 0) {
+        node->interestRate = rate;
+    }
+}
+
+static void printHoldingUpdate(const char* kind, WealthNode* node) {
+    if (inUpdateBatch() || g_engineQuiet) return;
+    printf("%s '%s' updated. New Value: %.2f", kind, node->name, node->value);
+    if (node->fxSlot >= 0) {
+        printf(" (%s %.2f)", fxCurrencyCode(node->currencyId), fxHoldingNativeValue(node));
+    }
+    printf(", Rate: %.1f%%\n", node->interestRate);
+}
+
+int manageStockInCurrency(UserProfile* user, const char* ticker, double amount, double rate, int isAdding, const char* currency) {
+    if (!user || !user->wealthTreeRoot) return 0;
 
     WealthNode* investments = findWealthNode(user->wealthTreeRoot, "Investments");
-    if (!investments) return;
+    if (!investments) return 0;
     
     WealthNode* stockCategory = findWealthNode(investments, "stock");
-    if (!stockCategory) return; 
+    if (!stockCategory) return 0; 
 
-    WealthNode* specificStock = findWealthNode(stockCategory, ticker);
+    WealthNode* specificStock = findStockHolding(user, ticker);
 
     if (!specificStock) {
         if (isAdding) {
@@ -311,29 +588,23 @@ void manageStock(UserProfile* user, const char* ticker, double amount, double ra
             addWealthChild(stockCategory, specificStock);
         } else {
             printf("Error: You do not own any stock named '%s'. Cannot update.\n", ticker);
-            return;
+            return 0;
         }
     }
 
-    if (isAdding) {
-        specificStock->value += amount;
-    } else {
-        specificStock->value = amount; 
-    }
-    
-    if (rate >= 0) {
-        specificStock->interestRate = rate;
-    }
+    if (resolveHoldingCurrency(user, specificStock, currency) == -1) return 0;
+    applyHoldingChange(specificStock, amount, rate, isAdding);
 
-    printf("Stock '%s' updated. New Value: %.2f, Rate: %.1f%%\n", ticker, specificStock->value, specificStock->interestRate);
+    printHoldingUpdate("Stock", specificStock);
     finalizeUserUpdates(user);
+    return 1;
 }
 
-void manageAsset(UserProfile* user, const char* assetName, double amount, double rate, int isAdding) {
-    if (!user || !user->wealthTreeRoot) return;
+int manageAssetInCurrency(UserProfile* user, const char* assetName, double amount, double rate, int isAdding, const char* currency) {
+    if (!user || !user->wealthTreeRoot) return 0;
 
     WealthNode* investments = findWealthNode(user->wealthTreeRoot, "Investments");
-    if (!investments) return;
+    if (!investments) return 0;
 
     WealthNode* assetNode = findWealthNode(investments, assetName);
     
@@ -342,18 +613,20 @@ void manageAsset(UserProfile* user, const char* assetName, double amount, double
         addWealthChild(investments, assetNode);
     }
 
-    if (isAdding) {
-        assetNode->value += amount;
-    } else {
-        assetNode->value = amount;
-    }
-
-    if (rate >= 0) {
-        assetNode->interestRate = rate;
-    }
+    if (resolveHoldingCurrency(user, assetNode, currency) == -1) return 0;
+    applyHoldingChange(assetNode, amount, rate, isAdding);
     
-    printf("Asset '%s' updated. New Value: %.2f, Rate: %.1f%%\n", assetName, assetNode->value, assetNode->interestRate);
+    printHoldingUpdate("Asset", assetNode);
     finalizeUserUpdates(user);
+    return 1;
+}
+
+void manageStock(UserProfile* user, const char* ticker, double amount, double rate, int isAdding) {
+    manageStockInCurrency(user, ticker, amount, rate, isAdding, NULL);
+}
+
+void manageAsset(UserProfile* user, const char* assetName, double amount, double rate, int isAdding) {
+    manageAssetInCurrency(user, assetName, amount, rate, isAdding, NULL);
 }
 
 void setWealthNodeValue(UserProfile* user, const char* nodeName, double newValue) {
@@ -367,18 +640,38 @@ void updateExpenseCategoryTotal(UserProfile* user, const char* category, double
     WealthNode* expensesRoot = findWealthNode(user->wealthTreeRoot, "Expenses"); 
     if (!expensesRoot) return;
     WealthNode* node = findWealthNode(expensesRoot, category);
-    if (node) node->value += amount;
+    if (!node) return;
+    node->value += amount;
+    if (node->firstRule != -1) evaluateNodeRules(node, amount);
 }
 
-void registerNewUser(const char* name) {
-    if (!name || strlen(name) == 0) return; 
+/* A profile with no tree and no history, not yet in the heap. */
+UserProfile* createUserProfile(const char* name) {
+    if (!name || strlen(name) == 0) return NULL;
     UserProfile* user = (UserProfile*)malloc(sizeof(UserProfile));
-    if (!user) return; 
+    if (!user) return NULL;
 
     strncpy(user->name, name, 49);
     user->name[49] = '\0';
     user->netWorth = 0.0;
+    user->heapId = -1;
+    user->pendingFinalize = 0;
+    user->scheduleListHead = NULL;
+    user->history = NULL;
+    user->firstAlertRule = -1;
+    user->alertInbox = NULL;
     user->expenseListHead = NULL;
+    user->expenseListTail = NULL;
+    user->coldLog = NULL;
+    user->lastAccess = engineNow();
+    user->rollupListHead = NULL;
+    user->wealthTreeRoot = NULL;
+    return user;
+}
+
+void registerNewUser(const char* name) {
+    UserProfile* user = createUserProfile(name);
+    if (!user) return; 
 
     user->wealthTreeRoot = createWealthNode(name, 0.0); 
     
@@ -405,19 +698,26 @@ void registerNewUser(const char* name) {
     heapInsert(g_userHeap, user);
 }
 
-void printExpenseLog(ExpenditureNode* head) {
-    if (!head) {
+void printExpenseLog(UserProfile* user) {
+    if (!user || (!user->expenseListHead && !user->coldLog)) {
         printf("No transactions found.\n");
         return;
     }
     printf("\n--- Transaction Log ---\n");
-    ExpenditureNode* temp = head;
-    while(temp != NULL) {
+    ExpenseCursor cursor;
+    openExpenseCursor(&cursor, user->expenseListHead, user->coldLog);
+    const ExpenditureNode* temp;
+    while ((temp = nextExpense(&cursor)) != NULL) {
         char* timeStr = ctime(&temp->date); 
         timeStr[strcspn(timeStr, "\n")] = 0; 
         printf("  [%s] %s - Rs.%.2f (%s)\n", 
                temp->category, temp->description, temp->amount, timeStr);
-        temp = temp->next;
+    }
+    if (user->coldLog) {
+        size_t stored = coldLogMemoryUsage(user->coldLog);
+        size_t expanded = (size_t)user->coldLog->count * sizeof(ExpenditureNode);
+        printf("(%d older entries kept compressed in %zu bytes instead of %zu.)\n",
+               user->coldLog->count, stored, expanded);
     }
 }
 